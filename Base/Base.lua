@@ -32,9 +32,7 @@ function Base.onClientChat(client, message)
         return
     end
     print(Escapes.CYAN .. client:player():character().name .. "/" .. client:address() .. ": " .. event.message .. Escapes.RESET)
-    for k, c in ipairs(Game.clients()) do
-        c:sendMessage(event.message, client:id())
-    end
+    Game.broadcastMessage(event.message, client:id())
 end
 
 function Base.onClientSyncProjectile(client, proj)
@@ -53,7 +51,8 @@ function Base.onClientSyncProjectile(client, proj)
         client:killProjectile(event.projectile.id, client:id())
     else
         local projId = Game.addProjectile(event.projectile, event.projectile.id)
-        for i, c in pairs(Game.clients()) do
+        -- Only the clients close enough to see the projectile care about it
+        for i, c in pairs(Game.clientsNear(event.projectile.position)) do
             if event.syncToOwner or c:id() ~= event.projectile.owner then
                 c:syncProjectile(projId)
             end
@@ -13,9 +13,7 @@ local Utilities = {}
 
 function Utilities.broadcast(text, color)
     color = color or { r = 255, g = 255, b = 255 }
-    for _, c in pairs(Game.clients()) do
-        c:sendMessage(text, 255, color)
-    end
+    Game.broadcastMessage(text, 255, color)
 end
 
 function Utilities.findClients(partOfName)
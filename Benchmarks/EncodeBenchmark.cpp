@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Time.h>
+#include <LibCore/ArgsParser.h>
+#include <LibMain/Main.h>
+#include <LibTerraria/Net/Packets/ClientUUID.h>
+#include <LibTerraria/Net/Packets/SyncPlayer.h>
+#include <LibTerraria/Net/Packets/SyncProjectile.h>
+#include <stdlib.h>
+
+// How long it takes to turn a packet into the bytes that go out on the socket, length and all: through to_bytes() and
+// a copy behind the length like packets used to be sent, and straight into their final buffer through encode_into().
+
+template<typename Callback>
+static void measure(StringView name, int iterations, Callback callback)
+{
+    u64 bytes = 0;
+    auto start = Time::now_monotonic();
+    for (int i = 0; i < iterations; i++)
+        bytes += callback();
+    auto nanoseconds = max<i64>((Time::now_monotonic() - start).to_nanoseconds(), 1);
+
+    outln("  {:<12} {:>8.2} ns/packet, {:>8.2} MiB/s", name, static_cast<double>(nanoseconds) / iterations,
+          static_cast<double>(bytes) / MiB / (static_cast<double>(nanoseconds) / 1'000'000'000));
+}
+
+static void benchmark(StringView name, const Terraria::Net::Packet& packet, int iterations)
+{
+    outln("{}:", name);
+
+    measure("to_bytes()", iterations, [&]() -> size_t {
+        auto packet_bytes = packet.to_bytes();
+        auto size = packet_bytes.size() + sizeof(u16);
+        auto* buffer = static_cast<u8*>(malloc(size));
+        VERIFY(buffer);
+        u16 length = size;
+        __builtin_memcpy(buffer, &length, sizeof(length));
+        __builtin_memcpy(buffer + sizeof(length), packet_bytes.data(), packet_bytes.size());
+        free(buffer);
+        return size;
+    });
+
+    if (!packet.encoded_size().has_value())
+    {
+        outln("  {:<12} not supported by this packet", "encode_into()");
+        return;
+    }
+
+    measure("encode_into()", iterations, [&]() -> size_t {
+        auto size = *packet.encoded_size();
+        auto* buffer = static_cast<u8*>(malloc(size));
+        VERIFY(buffer);
+        packet.encode_into({buffer, size});
+        free(buffer);
+        return size;
+    });
+}
+
+ErrorOr<int> serenity_main(Main::Arguments arguments)
+{
+    Core::ArgsParser args_parser;
+
+    int iterations = 1'000'000;
+    args_parser.add_option(iterations, "How many times to encode every packet", "iterations", 0, "count");
+
+    if (!args_parser.parse(arguments))
+        return 1;
+
+    // A player in mid air, moving, which is what most SyncPlayers look like.
+    Terraria::Net::Packets::SyncPlayer sync_player;
+    sync_player.set_player_id(3);
+    sync_player.set_control_bits(0b0000'1001);
+    sync_player.set_selected_item(7);
+    sync_player.position() = {33'600.0f, 6'400.0f};
+    sync_player.velocity() = Terraria::EntityPoint{4.5f, -2.25f};
+    benchmark("SyncPlayer", sync_player, iterations);
+
+    // A projectile with every optional field present, which is as big as they get.
+    Terraria::Net::Packets::SyncProjectile sync_projectile;
+    sync_projectile.set_id(120);
+    sync_projectile.position() = {33'616.0f, 6'380.0f};
+    sync_projectile.velocity() = {10.0f, -1.0f};
+    sync_projectile.set_owner(3);
+    sync_projectile.set_type(14);
+    sync_projectile.ai()[0] = 1.0f;
+    sync_projectile.ai()[1] = 0.5f;
+    sync_projectile.banner_id_to_respond_to() = 0;
+    sync_projectile.damage() = 20;
+    sync_projectile.knockback() = 3.5f;
+    sync_projectile.original_damage() = 20;
+    sync_projectile.uuid() = 120;
+    benchmark("SyncProjectile", sync_projectile, iterations);
+
+    Terraria::Net::Packets::ClientUUID client_uuid;
+    client_uuid.set_uuid("01234567-89ab-cdef-0123-456789abcdef");
+    benchmark("ClientUUID", client_uuid, iterations);
+
+    return 0;
+}
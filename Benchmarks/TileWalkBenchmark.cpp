@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Time.h>
+#include <LibCore/ArgsParser.h>
+#include <LibMain/Main.h>
+#include <LibTerraria/ChunkedTileMap.h>
+#include <LibTerraria/Net/Packets/TileSection.h>
+#include <LibTerraria/PalettedTileMap.h>
+#include <LibTerraria/TileMap.h>
+
+// How long it takes to read every tile of a world, a tile section at a time, through at() like the encoders used to,
+// through for_each_in_rect() like they do now, and how long encoding the whole TileSection takes per tile.
+
+static constexpr u16 section_width = 200;
+static constexpr u16 section_height = 150;
+
+// Sky on top, dirt with walls behind it in the middle and stone below that, with a sprinkling of ore and wires, which
+// is roughly what a freshly generated world is made of.
+static void fill(Terraria::TileMap& tile_map)
+{
+    for (u16 y = 0; y < tile_map.height(); y++)
+    {
+        for (u16 x = 0; x < tile_map.width(); x++)
+        {
+            Terraria::Tile tile;
+            if (y >= tile_map.height() / 3)
+            {
+                using Id = Terraria::Tile::Block::Id;
+                auto id = y < tile_map.height() / 2 ? Id::Dirt : Id::Stone;
+                if ((x * 31 + y * 17) % 97 == 0)
+                    id = Id::Iron;
+                tile.set_block(Terraria::Tile::Block(id));
+                if (y < tile_map.height() / 2)
+                    tile.set_wall_id(static_cast<Terraria::Tile::WallId>(2));
+                if ((x + y) % 61 == 0)
+                    tile.set_red_wire(true);
+            }
+            tile_map.set({x, y}, tile);
+        }
+    }
+}
+
+template<typename Callback>
+static void for_each_section(const Terraria::TileMap& tile_map, Callback callback)
+{
+    for (u16 y = 0; y < tile_map.height(); y += section_height)
+    {
+        for (u16 x = 0; x < tile_map.width(); x += section_width)
+            callback(Terraria::TilePoint{x, y}, min<u16>(section_width, tile_map.width() - x),
+                     min<u16>(section_height, tile_map.height() - y));
+    }
+}
+
+template<typename Callback>
+static void measure(StringView name, const Terraria::TileMap& tile_map, int iterations, Callback callback)
+{
+    u64 checksum = 0;
+    auto start = Time::now_monotonic();
+    for (int i = 0; i < iterations; i++)
+        checksum += callback();
+    auto nanoseconds = (Time::now_monotonic() - start).to_nanoseconds();
+
+    auto tiles = static_cast<u64>(tile_map.width()) * tile_map.height() * iterations;
+    outln("  {:<20} {:>8.2} ns/tile (checksum {})", name, static_cast<double>(nanoseconds) / tiles, checksum);
+}
+
+static void benchmark(StringView name, const Terraria::TileMap& tile_map, int iterations)
+{
+    outln("{} ({}x{}):", name, tile_map.width(), tile_map.height());
+
+    measure("at()", tile_map, iterations, [&]() {
+        u64 sum = 0;
+        for_each_section(tile_map, [&](const Terraria::TilePoint& origin, u16 width, u16 height) {
+            for (u16 y = origin.y(); y < origin.y() + height; y++)
+            {
+                for (u16 x = origin.x(); x < origin.x() + width; x++)
+                    sum += static_cast<u16>(tile_map.at(x, y).block_id());
+            }
+        });
+        return sum;
+    });
+
+    measure("for_each_in_rect()", tile_map, iterations, [&]() {
+        u64 sum = 0;
+        for_each_section(tile_map, [&](const Terraria::TilePoint& origin, u16 width, u16 height) {
+            tile_map.for_each_in_rect(origin, width, height,
+                                      [&](const Terraria::Tile& tile) { sum += static_cast<u16>(tile.block_id()); });
+        });
+        return sum;
+    });
+
+    measure("TileSection", tile_map, iterations, [&]() {
+        u64 sum = 0;
+        for_each_section(tile_map, [&](const Terraria::TilePoint& origin, u16 width, u16 height) {
+            Terraria::Net::Packets::TileSection tile_section(tile_map, origin.x(), origin.y(), width, height);
+            sum += tile_section.to_bytes().size();
+        });
+        return sum;
+    });
+}
+
+ErrorOr<int> serenity_main(Main::Arguments arguments)
+{
+    Core::ArgsParser args_parser;
+
+    // A small world by default.
+    int width = 4200;
+    int height = 1200;
+    int iterations = 5;
+
+    args_parser.add_option(width, "Width of the world in tiles", "width", 0, "tiles");
+    args_parser.add_option(height, "Height of the world in tiles", "height", 0, "tiles");
+    args_parser.add_option(iterations, "How many times to walk the whole world", "iterations", 0, "count");
+
+    if (!args_parser.parse(arguments))
+        return 1;
+
+    auto run = [&](StringView name, NonnullRefPtr<Terraria::TileMap> tile_map) {
+        fill(*tile_map);
+        benchmark(name, *tile_map, iterations);
+    };
+
+    run("memory", adopt_ref(*new Terraria::MemoryTileMap(width, height)));
+    run("chunked", adopt_ref(*new Terraria::ChunkedTileMap(width, height)));
+    run("paletted", adopt_ref(*new Terraria::PalettedTileMap(width, height)));
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <LibTerraria/ChunkedTileMap.h>
+
+namespace Terraria
+{
+ChunkedTileMap::ChunkedTileMap(u16 width, u16 height)
+    : m_width(width), m_height(height), m_chunks_wide((width + chunk_width - 1) / chunk_width)
+{
+    auto chunks_high = (height + chunk_height - 1) / chunk_height;
+    m_chunks.ensure_capacity(m_chunks_wide * chunks_high);
+    for (auto i = 0; i < m_chunks_wide * chunks_high; i++)
+        m_chunks.append(adopt_ref(*new Chunk));
+}
+
+ChunkedTileMap::ChunkedTileMap(u16 width, u16 height, Vector<NonnullRefPtr<Chunk>> chunks)
+    : m_width(width), m_height(height), m_chunks_wide((width + chunk_width - 1) / chunk_width), m_chunks(move(chunks))
+{
+}
+
+NonnullRefPtr<TileMap> ChunkedTileMap::snapshot() const
+{
+    return adopt_ref(*new ChunkedTileMap(m_width, m_height, m_chunks));
+}
+
+size_t ChunkedTileMap::shared_chunk_count() const
+{
+    size_t count = 0;
+    for (auto& chunk : m_chunks)
+    {
+        if (chunk->ref_count() > 1)
+            count++;
+    }
+
+    return count;
+}
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/NonnullRefPtr.h>
+#include <AK/RefCounted.h>
+#include <AK/Vector.h>
+#include <LibTerraria/TileMap.h>
+
+namespace Terraria
+{
+// A tile map split into chunks the size of a tile frame section. Chunks are shared between a map and its snapshots,
+// and only copied once somebody writes to a shared one, so a snapshot only costs a pointer per chunk.
+class ChunkedTileMap : public TileMap
+{
+public:
+    static constexpr u16 chunk_width = 200;
+    static constexpr u16 chunk_height = 150;
+
+    ChunkedTileMap(u16 width, u16 height);
+
+    u16 width() const override { return m_width; }
+
+    u16 height() const override { return m_height; }
+
+    Tile at(const TilePoint& position) const override
+    {
+        return m_chunks.at(chunk_index_for_position(position))->tiles[index_in_chunk(position)];
+    }
+
+    Tile& at(const TilePoint& position) override
+    {
+        return writable_chunk(chunk_index_for_position(position)).tiles[index_in_chunk(position)];
+    }
+
+    ALWAYS_INLINE Tile& at(u16 x, u16 y) { return at({x, y}); }
+
+    ALWAYS_INLINE Tile at(u16 x, u16 y) const { return at({x, y}); }
+
+    Span<const Tile> row_span(const TilePoint& start, u16 max_length) const override
+    {
+        auto& chunk = m_chunks.at(chunk_index_for_position(start));
+        auto length = min<size_t>(max_length, min(chunk_width - (start.x() % chunk_width), m_width - start.x()));
+        return chunk->tiles.span().slice(index_in_chunk(start), length);
+    }
+
+    NonnullRefPtr<TileMap> snapshot() const override;
+
+    size_t chunk_count() const { return m_chunks.size(); }
+
+    // How many chunks are currently shared with a snapshot, and would be copied on their next write.
+    size_t shared_chunk_count() const;
+
+private:
+    class Chunk : public RefCounted<Chunk>
+    {
+    public:
+        Array<Tile, chunk_width * chunk_height> tiles;
+    };
+
+    ChunkedTileMap(u16 width, u16 height, Vector<NonnullRefPtr<Chunk>> chunks);
+
+    ALWAYS_INLINE size_t chunk_index_for_position(const TilePoint& position) const
+    {
+        VERIFY(position.x() < m_width && position.y() < m_height);
+        return (position.x() / chunk_width) + (m_chunks_wide * (position.y() / chunk_height));
+    }
+
+    ALWAYS_INLINE static size_t index_in_chunk(const TilePoint& position)
+    {
+        return (position.x() % chunk_width) + (chunk_width * (position.y() % chunk_height));
+    }
+
+    ALWAYS_INLINE Chunk& writable_chunk(size_t index)
+    {
+        auto& chunk = m_chunks.at(index);
+        // Somebody else can still see this chunk, so it has to stay the way it is.
+        if (chunk->ref_count() > 1)
+        {
+            auto copy = adopt_ref(*new Chunk);
+            copy->tiles = chunk->tiles;
+            chunk = move(copy);
+        }
+
+        return *chunk;
+    }
+
+    const u16 m_width;
+    const u16 m_height;
+    const u16 m_chunks_wide;
+    Vector<NonnullRefPtr<Chunk>> m_chunks;
+};
+}
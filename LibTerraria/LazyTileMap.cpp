@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <LibCore/ElapsedTimer.h>
+#include <LibTerraria/LazyTileMap.h>
+
+namespace Terraria
+{
+LazyTileMap::LazyTileMap(NonnullRefPtr<Core::MappedFile> mapped_file, ReadonlyBytes tiles, u16 width, u16 height,
+                         Vector<bool> importance, Vector<size_t> column_offsets)
+    : m_width(width), m_height(height), m_mapped_file(move(mapped_file)), m_importance(move(importance)),
+      m_column_offsets(move(column_offsets)), m_decoder(tiles, width, height, m_importance)
+{
+    auto total_blocks = (width + columns_per_block - 1) / columns_per_block;
+    m_blocks.resize(total_blocks);
+    m_block_states.resize(total_blocks);
+}
+
+LazyTileMap::~LazyTileMap()
+{
+    if (m_background_thread)
+    {
+        m_stop_background_decoding.store(true);
+        (void)m_background_thread->join();
+    }
+}
+
+Tile LazyTileMap::at(const TilePoint& position) const
+{
+    auto block = position.x() / columns_per_block;
+    ensure_decoded(block);
+    return m_blocks[block][index_in_block(position)];
+}
+
+Tile& LazyTileMap::at(const TilePoint& position)
+{
+    auto block = position.x() / columns_per_block;
+    ensure_decoded(block);
+    return m_blocks[block][index_in_block(position)];
+}
+
+Span<const Tile> LazyTileMap::row_span(const TilePoint& start, u16 max_length) const
+{
+    VERIFY(start.x() < m_width && start.y() < m_height);
+    auto block = start.x() / columns_per_block;
+    ensure_decoded(block);
+
+    auto column_in_block = start.x() % columns_per_block;
+    auto length = min<size_t>(max_length, min(columns_per_block - column_in_block, m_width - start.x()));
+    return m_blocks[block].span().slice(index_in_block(start), length);
+}
+
+NonnullRefPtr<TileMap> LazyTileMap::snapshot() const
+{
+    auto copy = adopt_ref(*new MemoryTileMap(m_width, m_height));
+    for (u16 block = 0; block < m_blocks.size(); block++)
+    {
+        ensure_decoded(block);
+
+        auto first_column = block * columns_per_block;
+        auto columns = min(columns_per_block, m_width - first_column);
+        for (u16 y = 0; y < m_height; y++)
+        {
+            for (u16 x = 0; x < columns; x++)
+                copy->at(first_column + x, y) = m_blocks[block][x + (columns_per_block * y)];
+        }
+    }
+
+    return copy;
+}
+
+void LazyTileMap::decode_or_wait_for(u16 block) const
+{
+    u8 expected = Pending;
+    if (atomic_compare_exchange_strong(&m_block_states[block], expected, static_cast<u8>(Decoding),
+                                       AK::memory_order_acq_rel))
+    {
+        decode(block);
+
+        Threading::MutexLocker locker(m_mutex);
+        atomic_store(&m_block_states[block], static_cast<u8>(Decoded), AK::memory_order_release);
+        m_decoded_blocks++;
+        m_block_decoded.broadcast();
+        return;
+    }
+
+    // Somebody else got to this block first, so we just have to wait for them to finish it.
+    Threading::MutexLocker locker(m_mutex);
+    while (atomic_load(&m_block_states[block], AK::memory_order_acquire) != Decoded)
+        m_block_decoded.wait();
+}
+
+void LazyTileMap::decode(u16 block) const
+{
+    auto first_column = block * columns_per_block;
+    auto columns = min(columns_per_block, m_width - first_column);
+    auto& tiles = m_blocks[block];
+    tiles.resize(columns_per_block * m_height);
+
+    auto result = m_decoder.for_each_tile_run(first_column, columns, m_column_offsets[first_column],
+                                              [&](u16 x, u16 y, u16 length, const Tile& tile) {
+                                                  auto index = index_in_block({x, y});
+                                                  for (u16 i = 0; i < length; i++, index += columns_per_block)
+                                                      tiles[index] = tile;
+                                              });
+
+    // The column offsets were found by walking this exact data, so it can't fail to decode now.
+    VERIFY(!result.is_error());
+}
+
+void LazyTileMap::start_background_decoding(u16 starting_column)
+{
+    VERIFY(!m_background_thread);
+    auto starting_block = min(starting_column, m_width - 1) / columns_per_block;
+    m_background_thread = Threading::Thread::construct(
+        [this, starting_block]() { return decode_in_background(starting_block); }, "Lazy tile decoding"sv);
+    m_background_thread->start();
+}
+
+intptr_t LazyTileMap::decode_in_background(u16 starting_block)
+{
+    Core::ElapsedTimer timer;
+    timer.start();
+
+    // Go back and forth around the starting block, so whatever is closest to it gets decoded first.
+    auto total_blocks = static_cast<int>(m_blocks.size());
+    for (int distance = 0; distance < total_blocks; distance++)
+    {
+        for (int block : {starting_block - distance, starting_block + distance})
+        {
+            if (m_stop_background_decoding.load())
+                return 0;
+
+            if (block < 0 || block >= total_blocks)
+                continue;
+
+            ensure_decoded(block);
+        }
+    }
+
+    dbgln("Finished decoding {} tile blocks in the background after {}ms", total_blocks, timer.elapsed());
+
+    // Nothing will ever read from the world file again.
+    m_mapped_file = nullptr;
+    return 0;
+}
+}
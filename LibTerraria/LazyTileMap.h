@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Vector.h>
+#include <LibCore/MappedFile.h>
+#include <LibTerraria/TileColumnDecoder.h>
+#include <LibTerraria/TileMap.h>
+#include <LibThreading/ConditionVariable.h>
+#include <LibThreading/Mutex.h>
+#include <LibThreading/Thread.h>
+
+namespace Terraria
+{
+// A tile map that decodes its tiles straight out of a mapped world file the first time they are touched, a block of
+// columns at a time. A background thread decodes whatever nobody has touched yet, and the mapping is released once
+// every block has been decoded.
+class LazyTileMap : public TileMap
+{
+public:
+    static constexpr u16 columns_per_block = 200;
+
+    // The tile section must have already been scanned for its column offsets, which also validates it, because
+    // there is no way of reporting a decoding error out of at().
+    LazyTileMap(NonnullRefPtr<Core::MappedFile>, ReadonlyBytes tiles, u16 width, u16 height, Vector<bool> importance,
+                Vector<size_t> column_offsets);
+
+    ~LazyTileMap();
+
+    u16 width() const override { return m_width; }
+
+    u16 height() const override { return m_height; }
+
+    Tile at(const TilePoint& position) const override;
+
+    Tile& at(const TilePoint& position) override;
+
+    ALWAYS_INLINE Tile& at(u16 x, u16 y) { return at({x, y}); }
+
+    ALWAYS_INLINE Tile at(u16 x, u16 y) const { return at({x, y}); }
+
+    Span<const Tile> row_span(const TilePoint& start, u16 max_length) const override;
+
+    // This has to decode everything that hasn't been yet, and makes a full copy.
+    NonnullRefPtr<TileMap> snapshot() const override;
+
+    // Starts decoding every block nobody has asked for yet, starting from the one containing this column and moving
+    // outwards, so whatever is around spawn is ready first.
+    void start_background_decoding(u16 starting_column);
+
+    bool is_fully_decoded() const { return m_decoded_blocks.load() == m_blocks.size(); }
+
+private:
+    enum BlockState : u8
+    {
+        Pending,
+        Decoding,
+        Decoded
+    };
+
+    ALWAYS_INLINE void ensure_decoded(u16 block) const
+    {
+        if (atomic_load(&m_block_states[block], AK::memory_order_acquire) != Decoded)
+            decode_or_wait_for(block);
+    }
+
+    ALWAYS_INLINE size_t index_in_block(const TilePoint& position) const
+    {
+        return (position.x() % columns_per_block) + (columns_per_block * position.y());
+    }
+
+    void decode_or_wait_for(u16 block) const;
+
+    void decode(u16 block) const;
+
+    intptr_t decode_in_background(u16 starting_block);
+
+    const u16 m_width;
+    const u16 m_height;
+    mutable RefPtr<Core::MappedFile> m_mapped_file;
+    Vector<bool> m_importance;
+    Vector<size_t> m_column_offsets;
+    TileColumnDecoder m_decoder;
+
+    // Every block is laid out row by row, as if it were a tile map of its own that's columns_per_block wide.
+    mutable Vector<Vector<Tile>> m_blocks;
+    mutable Vector<u8> m_block_states;
+    mutable Atomic<size_t> m_decoded_blocks{0};
+    mutable Threading::Mutex m_mutex;
+    mutable Threading::ConditionVariable m_block_decoded{m_mutex};
+    RefPtr<Threading::Thread> m_background_thread;
+    Atomic<bool> m_stop_background_decoding{false};
+};
+}
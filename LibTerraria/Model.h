@@ -75,4 +75,5 @@ extern const int s_total_items;
 extern const int s_total_tiles;
 extern const int s_total_walls;
 extern const int s_total_prefixes;
+extern const int s_total_tile_objects;
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 
 #include <AK/ByteBuffer.h>
 #include <AK/Format.h>
+#include <AK/Optional.h>
 #include <AK/Stream.h>
 
 namespace Terraria::Net
@@ -69,6 +70,13 @@ public:
     virtual const char* packet_name() const { VERIFY_NOT_REACHED(); }
 
     virtual ByteBuffer to_bytes() const { VERIFY_NOT_REACHED(); }
+
+    // How many bytes encode_into() needs, including the length in front of the packet. Packets whose size can't be
+    // known without encoding them leave this empty, and have to go through to_bytes() instead.
+    virtual Optional<size_t> encoded_size() const { return {}; }
+
+    // Writes the packet, with its length in front, into exactly encoded_size() bytes.
+    virtual void encode_into(Bytes) const { VERIFY_NOT_REACHED(); }
 };
 }
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/Function.h>
+#include <AK/HashMap.h>
+#include <AK/MemoryStream.h>
+#include <AK/Noncopyable.h>
+#include <AK/Optional.h>
+#include <AK/Time.h>
+#include <LibTerraria/Net/Packet.h>
+
+namespace Terraria::Net
+{
+// A table of handlers indexed by packet id, so finding the handler for a packet is a single lookup. Every packet
+// definition knows its own packet_id (and module_id, for net modules), so registering a handler is all it takes to
+// start receiving a packet.
+template<typename Context>
+class PacketDispatcher
+{
+    // The handlers hold onto this dispatcher to tell it how long decoding took.
+    AK_MAKE_NONCOPYABLE(PacketDispatcher);
+    AK_MAKE_NONMOVABLE(PacketDispatcher);
+
+public:
+    PacketDispatcher() = default;
+
+    using Handler = Function<void(Context&, InputMemoryStream&)>;
+
+    // Decoding is whatever happens before the handler is called, and handling is everything after.
+    struct Timings
+    {
+        Time decode_time;
+        Time handle_time;
+    };
+
+    // Decodes the packet before handing it over, the handler isn't called if it failed to decode or ran out of bytes.
+    template<typename PacketType>
+    void on(Function<void(Context&, PacketType&)> handler)
+    {
+        m_handlers[static_cast<u8>(PacketType::packet_id)] = decode_and_handle(move(handler));
+    }
+
+    template<typename PacketType>
+    void on_module(Function<void(Context&, PacketType&)> handler)
+    {
+        m_module_handlers.set(static_cast<u16>(PacketType::module_id), decode_and_handle(move(handler)));
+    }
+
+    // Hands over a view of the packet instead, which reads straight out of the received bytes and so can't be kept
+    // around after the handler returns.
+    template<typename PacketType>
+    void on_view(Function<void(Context&, const typename PacketType::View&)> handler)
+    {
+        m_handlers[static_cast<u8>(PacketType::packet_id)] = view_and_handle<PacketType>(move(handler));
+    }
+
+    template<typename PacketType>
+    void on_module_view(Function<void(Context&, const typename PacketType::View&)> handler)
+    {
+        m_module_handlers.set(static_cast<u16>(PacketType::module_id), view_and_handle<PacketType>(move(handler)));
+    }
+
+    // For packets that have no data to decode, or need to read it themselves.
+    void on(Packet::Id id, Handler handler) { m_handlers[static_cast<u8>(id)] = move(handler); }
+
+    // Returns nothing if nothing handles this packet. Whether it decoded properly has to be checked on the stream.
+    Optional<Timings> dispatch(Context& context, Packet::Id id, InputMemoryStream& stream)
+    {
+        auto start = Time::now_monotonic();
+        m_decode_time = Time::zero();
+
+        if (id == Packet::Id::NetModules)
+        {
+            Packet::ModuleId module;
+            stream >> module;
+
+            // Modules we don't know about are dropped quietly, clients send plenty of them.
+            auto it = m_module_handlers.find(static_cast<u16>(module));
+            if (it != m_module_handlers.end())
+                it->value(context, stream);
+            return timings_since(start);
+        }
+
+        auto& handler = m_handlers[static_cast<u8>(id)];
+        if (!handler)
+            return {};
+
+        handler(context, stream);
+        return timings_since(start);
+    }
+
+private:
+    Timings timings_since(const Time& start) const
+    {
+        // Raw handlers decode the packet themselves, so all of their time counts as handling it.
+        return {m_decode_time, Time::now_monotonic() - start - m_decode_time};
+    }
+
+    template<typename PacketType>
+    Handler decode_and_handle(Function<void(Context&, PacketType&)> handler)
+    {
+        return [this, handler = move(handler)](Context& context, InputMemoryStream& stream) {
+            auto decode_start = Time::now_monotonic();
+            auto packet = PacketType::from_bytes(stream);
+            m_decode_time = Time::now_monotonic() - decode_start;
+            if (packet.has_value() && !stream.has_any_error())
+                handler(context, *packet);
+        };
+    }
+
+    template<typename PacketType>
+    Handler view_and_handle(Function<void(Context&, const typename PacketType::View&)> handler)
+    {
+        return [this, handler = move(handler)](Context& context, InputMemoryStream& stream) {
+            auto decode_start = Time::now_monotonic();
+            auto bytes = stream.bytes().slice(stream.offset());
+            auto view = PacketType::View::from_bytes(bytes);
+            m_decode_time = Time::now_monotonic() - decode_start;
+
+            // A view that doesn't fit is treated just like a packet that ran out of bytes while decoding.
+            if (!view.has_value())
+            {
+                stream.set_fatal_error();
+                return;
+            }
+
+            stream.discard_or_error(bytes.size());
+            handler(context, *view);
+        };
+    }
+
+    Array<Handler, 256> m_handlers;
+    HashMap<u16, Handler> m_module_handlers;
+
+    // Set by the handler that decoded the packet being dispatched.
+    Time m_decode_time;
+};
+}
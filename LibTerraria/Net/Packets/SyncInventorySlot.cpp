@@ -35,7 +35,6 @@ Optional<SyncInventorySlot> SyncInventorySlot::from_bytes(InputStream& stream)
 
 ByteBuffer SyncInventorySlot::to_bytes() const
 {
-    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncInventorySlot;
     DuplexMemoryStream stream;
     stream << packet_id;
 
@@ -16,6 +16,8 @@ namespace Terraria::Net::Packets
 class SyncInventorySlot : public Terraria::Net::Packet
 {
 public:
+    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncInventorySlot;
+
     const char* packet_name() const override { return "SyncInventorySlot"; }
 
     static Optional<SyncInventorySlot> from_bytes(InputStream& stream);
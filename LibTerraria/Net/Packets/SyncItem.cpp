@@ -39,7 +39,6 @@ Optional<SyncItem> SyncItem::from_bytes(InputStream& stream)
 
 ByteBuffer SyncItem::to_bytes() const
 {
-    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncItem;
     DuplexMemoryStream stream;
     stream << packet_id;
 
@@ -17,6 +17,8 @@ namespace Terraria::Net::Packets
 class SyncItem : public Terraria::Net::Packet
 {
 public:
+    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncItem;
+
     const char* packet_name() const override { return "SyncItem"; }
 
     static Optional<SyncItem> from_bytes(InputStream& stream);
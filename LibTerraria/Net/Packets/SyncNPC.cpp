@@ -94,7 +94,6 @@ Optional<SyncNPC> SyncNPC::from_bytes(InputStream& stream)
 
 ByteBuffer SyncNPC::to_bytes() const
 {
-    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncNPC;
     DuplexMemoryStream stream;
     stream << packet_id;
 
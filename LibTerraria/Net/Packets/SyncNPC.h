@@ -15,6 +15,8 @@ namespace Terraria::Net::Packets
 class SyncNPC : public Terraria::Net::Packet
 {
 public:
+    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncNPC;
+
     using AIArray = Array<Optional<float>, 4>;
 
     SyncNPC() = default;
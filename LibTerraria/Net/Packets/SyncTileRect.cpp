@@ -5,6 +5,7 @@
  */
 
 #include <AK/MemoryStream.h>
+#include <AK/Vector.h>
 #include <LibTerraria/Net/Packets/SyncTileRect.h>
 #include <LibTerraria/Net/Types.h>
 
@@ -12,7 +13,6 @@ namespace Terraria::Net::Packets
 {
 ByteBuffer SyncTileRect::to_bytes() const
 {
-    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncTileRect;
     DuplexMemoryStream stream;
     stream << packet_id;
     stream << m_position;
@@ -20,28 +20,33 @@ ByteBuffer SyncTileRect::to_bytes() const
     stream << m_height;
     stream << m_change_type;
 
+    // Copy the rect out row by row first, so the tile map is only asked once per row rather than once per tile.
+    Vector<Tile> tiles;
+    tiles.ensure_capacity(m_width * m_height);
+    m_tile_map.for_each_in_rect(m_position, m_width, m_height, [&](const Tile& tile) { tiles.unchecked_append(tile); });
+
     // Unlike TileSection, this packet is written x by y.
-    for (u16 x = m_position.x(); x < m_position.x() + m_width; x++)
+    for (u16 x = 0; x < m_width; x++)
     {
-        for (u16 y = m_position.y(); y < m_position.y() + m_height; y++)
+        for (u16 y = 0; y < m_height; y++)
         {
-            const auto& tile = m_tile_map.at({x, y});
+            const auto& tile = tiles[x + (m_width * y)];
 
             // Unlike TileSection, this packet only has two headers, but both are always present.
             u8 header1 = 0;
             u8 header2 = 0;
 
-            if (tile.block().has_value())
+            if (tile.has_block())
             {
                 header1 |= m_block_bit;
 
-                if (tile.block()->shape() == 1)
+                if (tile.shape() == 1)
                     header1 |= m_half_brick_bit;
-                else if (tile.block()->shape() > 1)
-                    header2 |= ((tile.block()->shape() - 1) << m_shape_shift) & m_shape_bits;
+                else if (tile.shape() > 1)
+                    header2 |= ((tile.shape() - 1) << m_shape_shift) & m_shape_bits;
             }
 
-            if (tile.wall_id().has_value())
+            if (tile.has_wall())
                 header1 |= m_wall_bit;
 
             if (tile.has_red_wire())
@@ -65,15 +70,18 @@ ByteBuffer SyncTileRect::to_bytes() const
             stream << header1;
             stream << header2;
 
-            if (tile.block().has_value())
+            if (tile.has_block())
             {
-                stream << static_cast<u16>(tile.block()->id());
+                stream << static_cast<u16>(tile.block_id());
 
-                stream << tile.block()->frame_x();
-                stream << tile.block()->frame_y();
+                if (tile.has_frames())
+                {
+                    stream << tile.frame_x();
+                    stream << tile.frame_y();
+                }
             }
 
-            if (tile.wall_id().has_value())
+            if (tile.has_wall())
                 stream << static_cast<u16>(*tile.wall_id());
         }
     }
@@ -17,6 +17,8 @@ namespace Terraria::Net::Packets
 class SyncTileRect : public Terraria::Net::Packet
 {
 public:
+    static constexpr auto packet_id = Terraria::Net::Packet::Id::SyncTileRect;
+
     SyncTileRect(const TileMap& tile_map, TilePoint pos, u8 width, u8 height)
         : m_tile_map(tile_map), m_position(move(pos)), m_width(width), m_height(height)
     {
@@ -51,7 +51,6 @@ ByteBuffer TeleportEntity::to_bytes() const
     if (m_extra_info.has_value())
         flags |= m_extra_info_bit;
 
-    static constexpr auto packet_id = Terraria::Net::Packet::Id::TeleportEntity;
     DuplexMemoryStream stream;
     stream << packet_id;
     stream << flags;
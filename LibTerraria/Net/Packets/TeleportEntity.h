@@ -16,6 +16,8 @@ namespace Terraria::Net::Packets
 class TeleportEntity : public Terraria::Net::Packet
 {
 public:
+    static constexpr auto packet_id = Terraria::Net::Packet::Id::TeleportEntity;
+
     enum class TeleportType : u8
     {
         PlayerToPosition,
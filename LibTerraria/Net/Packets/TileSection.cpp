@@ -5,19 +5,28 @@
  */
 
 #include <AK/MemoryStream.h>
+#include <AK/Time.h>
 #include <LibCompress/Deflate.h>
 #include <LibTerraria/Net/Packets/TileSection.h>
 
+// FIXME: Do what Serenity does with their debug macros
+#define TILE_SECTION_DEBUG 0
+
 namespace Terraria::Net::Packets
 {
 TileSection::TileSection(const TileMap& tile_map, i32 starting_x, i32 starting_y, u16 width, u16 height)
-    : m_tile_map(tile_map), m_starting_x(starting_x), m_starting_y(starting_y), m_width(width), m_height(height)
+    : m_tile_map(&tile_map), m_starting_x(starting_x), m_starting_y(starting_y), m_width(width), m_height(height)
+{
+}
+
+TileSection::TileSection(Span<const Tile> tiles, i32 starting_x, i32 starting_y, u16 width, u16 height)
+    : m_tiles(tiles), m_starting_x(starting_x), m_starting_y(starting_y), m_width(width), m_height(height)
 {
+    VERIFY(tiles.size() == static_cast<size_t>(width) * height);
 }
 
 ByteBuffer TileSection::to_bytes() const
 {
-    static constexpr auto packet_id = Terraria::Net::Packet::Id::TileSection;
     DuplexMemoryStream stream;
     DuplexMemoryStream stream_deflated;
     stream << packet_id;
@@ -28,104 +37,157 @@ ByteBuffer TileSection::to_bytes() const
     stream_deflated << m_width;
     stream_deflated << m_height;
 
-    for (u16 y = 0; y < m_height; y++)
-    {
-        for (u16 x = 0; x < m_width; x++)
+    auto encode_start = Time::now_monotonic();
+
+    auto write_tile = [&](const Tile& tile, i16 repeat) {
+        // There are 3 bitmask headers, of which the first is always present.
+        // The first header says if the second header is present.
+        // The second header says if the third header is present.
+        // TODO: Implement both additional headers and their values.
+        u8 header = 0;
+        u8 header2 = 0;
+        u8 header3 = 0;
+
+        bool additional_tile_byte = false;
+        bool additional_wall_byte = false;
+
+        if (tile.has_block())
         {
-            const auto& tile = m_tile_map.at(x + m_starting_x, y + m_starting_y);
-
-            // There are 3 bitmask headers, of which the first is always present.
-            // The first header says if the second header is present.
-            // The second header says if the third header is present.
-            // TODO: Implement both additional headers and their values.
-            u8 header = 0;
-            u8 header2 = 0;
-            u8 header3 = 0;
-
-            auto& block = tile.block();
-            auto& wall_id = tile.wall_id();
-            bool additional_tile_byte = false;
-            bool additional_wall_byte = false;
-
-            if (block.has_value())
+            header |= m_block_bit;
+            if (static_cast<u16>(tile.block_id()) > 255)
             {
-                header |= m_block_bit;
-                if (static_cast<u16>(block->id()) > 255)
-                {
-                    header |= m_additional_tile_byte_bit;
-                    additional_tile_byte = true;
-                }
+                header |= m_additional_tile_byte_bit;
+                additional_tile_byte = true;
             }
+        }
 
-            if (wall_id.has_value())
+        if (tile.has_wall())
+        {
+            header |= m_wall_bit;
+            if (static_cast<u16>(*tile.wall_id()) > 255)
             {
-                header |= m_wall_bit;
-                if (static_cast<u16>(*wall_id) > 255)
-                {
-                    header3 |= m_additional_wall_byte_bit;
-                    additional_wall_byte = true;
-                }
+                header3 |= m_additional_wall_byte_bit;
+                additional_wall_byte = true;
             }
+        }
+
+        if (tile.liquid_amount() != 0)
+            header |= tile.liquid() << m_liquid_shift;
 
-            if (tile.liquid_amount() != 0)
-                header |= tile.liquid() << m_liquid_shift;
+        if (tile.has_red_wire())
+            header2 |= m_red_wire_bit;
 
-            if (tile.has_red_wire())
-                header2 |= m_red_wire_bit;
+        if (tile.has_blue_wire())
+            header2 |= m_blue_wire_bit;
 
-            if (tile.has_blue_wire())
-                header2 |= m_blue_wire_bit;
+        if (tile.has_green_wire())
+            header2 |= m_green_wire_bit;
 
-            if (tile.has_green_wire())
-                header2 |= m_green_wire_bit;
+        if (tile.has_block())
+            header2 |= (tile.shape() << m_shape_shift) & m_shape_bits;
 
-            if (tile.block().has_value())
-                header2 |= (tile.block()->shape() << m_shape_shift) & m_shape_bits;
+        if (tile.has_yellow_wire())
+            header3 |= m_yellow_wire_bit;
 
-            if (tile.has_yellow_wire())
-                header3 |= m_yellow_wire_bit;
+        if (tile.has_actuator())
+            header3 |= m_actuator_bit;
 
-            if (tile.has_actuator())
-                header3 |= m_actuator_bit;
+        if (tile.is_actuated())
+            header3 |= m_actuated_bit;
+
+        // How many of the following tiles are the same as this one, which go on to the next row as they need to.
+        if (repeat > 255)
+            header |= 2 << m_rle_shift;
+        else if (repeat > 0)
+            header |= 1 << m_rle_shift;
+
+        if (header2 != 0)
+            header |= m_header_2_bit;
+
+        if (header3 != 0)
+        {
+            header |= m_header_2_bit;
+            header2 |= m_header_3_bit;
+        }
 
-            if (tile.is_actuated())
-                header3 |= m_actuated_bit;
+        stream_deflated << header;
+        if (header2 != 0)
+            stream_deflated << header2;
+        if (header3 != 0)
+            stream_deflated << header3;
 
-            if (header2 != 0)
-                header |= m_header_2_bit;
+        if (tile.has_block())
+        {
+            if (additional_tile_byte)
+                stream_deflated << static_cast<u16>(tile.block_id());
+            else
+                stream_deflated << static_cast<u8>(tile.block_id());
 
-            if (header3 != 0)
+            if (tile.has_frames())
             {
-                header |= m_header_2_bit;
-                header2 |= m_header_3_bit;
+                stream_deflated << tile.frame_x();
+                stream_deflated << tile.frame_y();
             }
+        }
 
-            stream_deflated << header;
-            if (header2 != 0)
-                stream_deflated << header2;
-            if (header3 != 0)
-                stream_deflated << header3;
+        if (tile.has_wall())
+            stream_deflated << static_cast<u8>(*tile.wall_id());
+
+        if (tile.liquid_amount() != 0)
+            stream_deflated << tile.liquid_amount();
+
+        if (additional_wall_byte)
+            stream_deflated << static_cast<u8>(static_cast<u16>(*tile.wall_id()) >> 8);
+
+        if (repeat > 255)
+            stream_deflated << repeat;
+        else if (repeat > 0)
+            stream_deflated << static_cast<u8>(repeat);
+    };
+
+    // Sky and solid stone make for very long runs of the same tile, so only write a tile once it's different from the
+    // one before it, along with how many times it repeated. The client reads that as an Int16, so a run longer than
+    // that has to be split, or it would come out negative.
+    Optional<Tile> run_tile;
+    i16 run_repeat = 0;
+    size_t runs = 0;
+    auto add_tile = [&](const Tile& tile) {
+        if (run_tile.has_value() && *run_tile == tile && run_repeat < NumericLimits<i16>::max())
+        {
+            run_repeat++;
+            return;
+        }
 
-            if (block.has_value())
-            {
-                if (additional_tile_byte)
-                    stream_deflated << static_cast<u16>(block->id());
-                else
-                    stream_deflated << static_cast<u8>(block->id());
+        if (run_tile.has_value())
+        {
+            write_tile(*run_tile, run_repeat);
+            runs++;
+        }
 
-                stream_deflated << block->frame_x();
-                stream_deflated << block->frame_y();
-            }
+        run_tile = tile;
+        run_repeat = 0;
+    };
 
-            if (wall_id.has_value())
-                stream_deflated << static_cast<u8>(*wall_id);
+    if (m_tile_map)
+        m_tile_map->for_each_in_rect({static_cast<u16>(m_starting_x), static_cast<u16>(m_starting_y)}, m_width,
+                                     m_height, add_tile);
+    else
+        for (auto& tile : m_tiles)
+            add_tile(tile);
 
-            if (tile.liquid_amount() != 0)
-                stream_deflated << tile.liquid_amount();
+    if (run_tile.has_value())
+    {
+        write_tile(*run_tile, run_repeat);
+        runs++;
+    }
 
-            if (additional_wall_byte)
-                stream_deflated << static_cast<u8>(static_cast<u16>(*wall_id) >> 8);
-        }
+    if constexpr (TILE_SECTION_DEBUG)
+    {
+        auto tile_count = m_width * m_height;
+        auto nanoseconds = (Time::now_monotonic() - encode_start).to_nanoseconds();
+        dbgln("Encoded {} tiles of a {}x{} tile section as {} runs ({} bytes) in {}ns, {}ns per tile", tile_count,
+              m_width, m_height, runs, stream_deflated.size(), nanoseconds,
+              tile_count == 0 ? 0 : nanoseconds / tile_count);
     }
 
     // TODO: Support chests, signs, and tile entities
@@ -133,10 +195,17 @@ ByteBuffer TileSection::to_bytes() const
     stream_deflated << static_cast<u16>(0); // Sign Count
     stream_deflated << static_cast<u16>(0); // Tile Entity Count
 
+    auto deflate_start = Time::now_monotonic();
     auto buffer_inflate = Compress::DeflateCompressor::compress_all(stream_deflated.copy_into_contiguous_buffer());
 
     stream << buffer_inflate;
 
+    if constexpr (TILE_SECTION_DEBUG)
+    {
+        dbgln("Deflated a {}x{} tile section to a {} byte packet in {}us", m_width, m_height, stream.size(),
+              (Time::now_monotonic() - deflate_start).to_microseconds());
+    }
+
     return stream.copy_into_contiguous_buffer();
 }
 
@@ -21,8 +21,14 @@ namespace Terraria::Net::Packets
 class TileSection : public Terraria::Net::Packet
 {
 public:
+    static constexpr auto packet_id = Terraria::Net::Packet::Id::TileSection;
+
     TileSection(const TileMap& tile_map, i32 starting_x, i32 starting_y, u16 width, u16 height);
 
+    // For when the tiles have been copied out of the world already, one row after another. They have to outlive the
+    // packet.
+    TileSection(Span<const Tile> tiles, i32 starting_x, i32 starting_y, u16 width, u16 height);
+
     const char* packet_name() const override { return "TileSection"; }
 
     static Optional<TileSection> from_bytes(InputStream& stream) { VERIFY_NOT_REACHED(); }
@@ -30,7 +36,9 @@ public:
     ByteBuffer to_bytes() const override;
 
 private:
-    const TileMap& m_tile_map;
+    // Only one of these is ever set.
+    const TileMap* m_tile_map{};
+    Span<const Tile> m_tiles;
     i32 m_starting_x;
     i32 m_starting_y;
     u16 m_width;
@@ -43,6 +51,7 @@ private:
     static constexpr u8 m_additional_tile_byte_bit = 0b0010'0000;
     static constexpr u8 m_liquid_bits = 0b0001'1000;
     static constexpr u8 m_liquid_shift = 3;
+    static constexpr u8 m_rle_shift = 6;
 
     // Header 2
     static constexpr u8 m_header_3_bit = 0b0000'0001;
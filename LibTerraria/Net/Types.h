@@ -6,7 +6,9 @@
 
 #pragma once
 
+#include <AK/NumericLimits.h>
 #include <AK/Optional.h>
+#include <AK/Span.h>
 #include <AK/Stream.h>
 #include <AK/String.h>
 #include <AK/Types.h>
@@ -19,6 +21,9 @@ namespace Terraria::Net
 class Types
 {
 public:
+    // A whole packet is at most this big, length and all, so no string in one can be any longer.
+    static constexpr u32 max_string_length = NumericLimits<u16>::max();
+
     static size_t write_7bit_encoded_int(OutputStream& stream, u32 value)
     {
         // This implements a .NET System.IO.BinaryWriter#Write7BitEncodedInt
@@ -61,6 +66,75 @@ public:
         return shift / 7;
     }
 
+    // Same as above, but straight out of bytes. Returns how many bytes the int took up, or nothing if it ran past the
+    // end of them.
+    static Optional<size_t> read_7bit_encoded_int(ReadonlyBytes bytes, size_t offset, u32& value)
+    {
+        value = 0;
+        for (size_t i = 0; i < 5; i++)
+        {
+            if (offset + i >= bytes.size())
+                return {};
+
+            u8 b = bytes[offset + i];
+            value |= (b & 0x7F) << (i * 7);
+            if ((b & 0x80) == 0)
+                return i + 1;
+        }
+
+        dbgln("7-bit encoded int has too many bytes!");
+        return {};
+    }
+
+    static constexpr size_t size_of_7bit_encoded_int(u32 value)
+    {
+        size_t size = 1;
+        for (; value >= 0x80; value >>= 7)
+            size++;
+        return size;
+    }
+
+    // The rest of these write straight into bytes that are already the right size, moving offset past what they wrote.
+    static void write_7bit_encoded_int(Bytes bytes, size_t& offset, u32 value)
+    {
+        for (; value >= 0x80; value >>= 7)
+            write(bytes, offset, static_cast<u8>(value | 0x80));
+        write(bytes, offset, static_cast<u8>(value));
+    }
+
+    template<typename T>
+    static void write(Bytes bytes, size_t& offset, const T& value)
+    {
+        VERIFY(offset + sizeof(T) <= bytes.size());
+        __builtin_memcpy(bytes.offset_pointer(offset), &value, sizeof(T));
+        offset += sizeof(T);
+    }
+
+    template<typename T>
+    static void write(Bytes bytes, size_t& offset, const Optional<T>& value)
+    {
+        if (value.has_value())
+            write(bytes, offset, *value);
+    }
+
+    template<typename T>
+    static constexpr size_t encoded_size_of(const Optional<T>& value)
+    {
+        return value.has_value() ? sizeof(T) : 0;
+    }
+
+    static size_t encoded_size_of_string(const String& value)
+    {
+        return size_of_7bit_encoded_int(value.length()) + value.length();
+    }
+
+    static void write_string(Bytes bytes, size_t& offset, const String& value)
+    {
+        write_7bit_encoded_int(bytes, offset, value.length());
+        bytes.overwrite(offset, value.characters(), value.length());
+        offset += value.length();
+    }
+
     static size_t write_string(OutputStream& stream, const String& value)
     {
         auto bytes_written = write_7bit_encoded_int(stream, value.length());
@@ -72,11 +146,24 @@ public:
     {
         u32 length;
         auto bytes_read = read_7bit_encoded_int(stream, length);
-        Vector<u8> characters;
-        characters.grow_capacity(length);
-        bytes_read += stream.read({characters.data(), length});
-        value = String(reinterpret_cast<char*>(characters.data()), length);
-        return bytes_read;
+        if (stream.has_any_error())
+            return bytes_read;
+
+        // The length comes from whoever sent it to us, so don't go allocating for a string that can't be there.
+        if (length > max_string_length)
+        {
+            stream.set_fatal_error();
+            return bytes_read;
+        }
+
+        // Read the characters right into the string, instead of somewhere else first.
+        char* characters;
+        auto string = StringImpl::create_uninitialized(length, characters);
+        if (!stream.read_or_error({characters, length}))
+            return bytes_read;
+
+        value = String(move(string));
+        return bytes_read + length;
     }
 };
 }
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/NumericLimits.h>
+#include <LibTerraria/PalettedTileMap.h>
+
+namespace Terraria
+{
+PalettedTileMap::PalettedTileMap(u16 width, u16 height)
+    : m_width(width), m_height(height), m_chunks_wide((width + chunk_width - 1) / chunk_width)
+{
+    auto chunks_high = (height + chunk_height - 1) / chunk_height;
+    m_chunks.resize(m_chunks_wide * chunks_high);
+}
+
+NonnullRefPtr<TileMap> PalettedTileMap::snapshot() const
+{
+    auto copy = adopt_ref(*new PalettedTileMap(m_width, m_height));
+    copy->m_chunks = m_chunks;
+    return copy;
+}
+
+size_t PalettedTileMap::memory_usage() const
+{
+    size_t total = 0;
+    for (auto& chunk : m_chunks)
+        total += chunk.memory_usage();
+
+    return total;
+}
+
+size_t PalettedTileMap::dense_chunk_count() const
+{
+    size_t count = 0;
+    for (auto& chunk : m_chunks)
+    {
+        if (chunk.is_dense())
+            count++;
+    }
+
+    return count;
+}
+
+void PalettedTileMap::Chunk::set(size_t index, const Tile& tile)
+{
+    if (is_dense())
+    {
+        m_dense[index] = tile;
+        return;
+    }
+
+    auto palette_index = find_in_palette(tile);
+    if (!palette_index.has_value())
+    {
+        if (m_palette.size() == (1u << m_bits_per_index) && !make_room_in_palette())
+        {
+            make_dense()[index] = tile;
+            return;
+        }
+
+        palette_index = m_palette.size();
+        m_palette.append(tile);
+        m_last_palette_index = *palette_index;
+    }
+
+    set_palette_index_at(index, *palette_index);
+}
+
+Optional<size_t> PalettedTileMap::Chunk::find_in_palette(const Tile& tile)
+{
+    // Tiles are mostly written in runs of the same one, so it's very likely the one we found last time.
+    if (m_palette[m_last_palette_index] == tile)
+        return m_last_palette_index;
+
+    for (size_t i = 0; i < m_palette.size(); i++)
+    {
+        if (m_palette[i] == tile)
+        {
+            m_last_palette_index = i;
+            return i;
+        }
+    }
+
+    return {};
+}
+
+bool PalettedTileMap::Chunk::make_room_in_palette()
+{
+    // Tiles that have been overwritten leave their palette entries behind, so get rid of those before we pay for
+    // another bit per tile.
+    drop_unused_palette_entries();
+    if (m_palette.size() < (1u << m_bits_per_index))
+        return true;
+
+    if (m_palette.size() >= max_palette_size)
+        return false;
+
+    widen_indices();
+    return true;
+}
+
+void PalettedTileMap::Chunk::drop_unused_palette_entries()
+{
+    static constexpr size_t unused = NumericLimits<size_t>::max();
+
+    Vector<size_t> remapped;
+    remapped.ensure_capacity(m_palette.size());
+    for (size_t i = 0; i < m_palette.size(); i++)
+        remapped.unchecked_append(unused);
+
+    Vector<Tile> palette;
+    for (size_t i = 0; i < tile_count; i++)
+    {
+        auto palette_index = palette_index_at(i);
+        if (remapped[palette_index] == unused)
+        {
+            remapped[palette_index] = palette.size();
+            palette.append(m_palette[palette_index]);
+        }
+    }
+
+    if (palette.size() == m_palette.size())
+        return;
+
+    for (size_t i = 0; i < tile_count; i++)
+        set_palette_index_at(i, remapped[palette_index_at(i)]);
+
+    m_palette = move(palette);
+    m_last_palette_index = 0;
+}
+
+void PalettedTileMap::Chunk::widen_indices()
+{
+    // Keep every index a power of two bits wide, so none of them ever straddle two words.
+    u8 bits_per_index = m_bits_per_index == 0 ? 1 : m_bits_per_index * 2;
+
+    Vector<u32> indices;
+    indices.resize((tile_count * bits_per_index + bits_per_word - 1) / bits_per_word);
+
+    for (size_t i = 0; i < tile_count; i++)
+    {
+        auto palette_index = palette_index_at(i);
+        auto bit = i * bits_per_index;
+        indices[bit / bits_per_word] |= palette_index << (bit % bits_per_word);
+    }
+
+    m_indices = move(indices);
+    m_bits_per_index = bits_per_index;
+}
+
+Vector<Tile>& PalettedTileMap::Chunk::make_dense()
+{
+    if (is_dense())
+        return m_dense;
+
+    m_dense.ensure_capacity(tile_count);
+    for (size_t i = 0; i < tile_count; i++)
+        m_dense.unchecked_append(m_palette[palette_index_at(i)]);
+
+    m_palette.clear();
+    m_indices.clear();
+    m_bits_per_index = 0;
+    m_last_palette_index = 0;
+    return m_dense;
+}
+
+size_t PalettedTileMap::Chunk::memory_usage() const
+{
+    if (is_dense())
+        return m_dense.size() * sizeof(Tile);
+
+    return (m_palette.size() * sizeof(Tile)) + (m_indices.size() * sizeof(u32));
+}
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <LibTerraria/TileMap.h>
+
+namespace Terraria
+{
+// A tile map for worlds that are mostly made of the same few tiles over and over again, like sky, stone and dirt.
+// Every 200x150 chunk stores each distinct tile it has once, in a palette, and every tile as an index into it, packed
+// down to as few bits as the palette needs. A chunk with too many distinct tiles to be worth it is stored densely.
+//
+// Replacing tiles should go through set(), which keeps the chunk paletted. Taking a mutable reference through at()
+// has to turn the chunk dense, as there is nothing else to give a reference to.
+class PalettedTileMap : public TileMap
+{
+public:
+    static constexpr u16 chunk_width = 200;
+    static constexpr u16 chunk_height = 150;
+
+    PalettedTileMap(u16 width, u16 height);
+
+    u16 width() const override { return m_width; }
+
+    u16 height() const override { return m_height; }
+
+    Tile at(const TilePoint& position) const override
+    {
+        return m_chunks.at(chunk_index_for_position(position)).at(index_in_chunk(position));
+    }
+
+    Tile& at(const TilePoint& position) override
+    {
+        return m_chunks.at(chunk_index_for_position(position)).make_dense().at(index_in_chunk(position));
+    }
+
+    ALWAYS_INLINE Tile& at(u16 x, u16 y) { return at({x, y}); }
+
+    ALWAYS_INLINE Tile at(u16 x, u16 y) const { return at({x, y}); }
+
+    // A paletted chunk doesn't store its tiles next to each other, so those are only ever a single tile long.
+    Span<const Tile> row_span(const TilePoint& start, u16 max_length) const override
+    {
+        auto length = min<size_t>(max_length, min(chunk_width - (start.x() % chunk_width), m_width - start.x()));
+        return m_chunks.at(chunk_index_for_position(start)).row_span(index_in_chunk(start), length);
+    }
+
+    void set(const TilePoint& position, const Tile& tile) override
+    {
+        m_chunks.at(chunk_index_for_position(position)).set(index_in_chunk(position), tile);
+    }
+
+    NonnullRefPtr<TileMap> snapshot() const override;
+
+    // Roughly how many bytes the tiles take up, not counting the bookkeeping of the vectors themselves.
+    size_t memory_usage() const;
+
+    size_t dense_chunk_count() const;
+
+private:
+    class Chunk
+    {
+    public:
+        static constexpr size_t tile_count = chunk_width * chunk_height;
+        static constexpr size_t max_palette_size = 256;
+
+        Chunk() { m_palette.append({}); }
+
+        ALWAYS_INLINE Tile at(size_t index) const
+        {
+            if (!m_dense.is_empty())
+                return m_dense[index];
+
+            return m_palette[palette_index_at(index)];
+        }
+
+        ALWAYS_INLINE Span<const Tile> row_span(size_t index, size_t max_length) const
+        {
+            if (!m_dense.is_empty())
+                return m_dense.span().slice(index, max_length);
+
+            return {&m_palette[palette_index_at(index)], 1};
+        }
+
+        void set(size_t index, const Tile&);
+
+        Vector<Tile>& make_dense();
+
+        bool is_dense() const { return !m_dense.is_empty(); }
+
+        size_t memory_usage() const;
+
+    private:
+        static constexpr size_t bits_per_word = sizeof(u32) * 8;
+
+        ALWAYS_INLINE size_t palette_index_at(size_t index) const
+        {
+            if (m_bits_per_index == 0)
+                return 0;
+
+            auto bit = index * m_bits_per_index;
+            return (m_indices[bit / bits_per_word] >> (bit % bits_per_word)) & ((1u << m_bits_per_index) - 1);
+        }
+
+        ALWAYS_INLINE void set_palette_index_at(size_t index, size_t palette_index)
+        {
+            // With a single entry in the palette there's nothing to store.
+            if (m_bits_per_index == 0)
+                return;
+
+            auto bit = index * m_bits_per_index;
+            auto mask = ((1u << m_bits_per_index) - 1) << (bit % bits_per_word);
+            auto& word = m_indices[bit / bits_per_word];
+            word = (word & ~mask) | ((palette_index << (bit % bits_per_word)) & mask);
+        }
+
+        Optional<size_t> find_in_palette(const Tile&);
+
+        bool make_room_in_palette();
+
+        void drop_unused_palette_entries();
+
+        void widen_indices();
+
+        // Only one of these is in use at once. The palette and indices are cleared once the chunk goes dense.
+        Vector<Tile> m_palette;
+        Vector<u32> m_indices;
+        u8 m_bits_per_index{};
+        size_t m_last_palette_index{};
+        Vector<Tile> m_dense;
+    };
+
+    ALWAYS_INLINE size_t chunk_index_for_position(const TilePoint& position) const
+    {
+        VERIFY(position.x() < m_width && position.y() < m_height);
+        return (position.x() / chunk_width) + (m_chunks_wide * (position.y() / chunk_height));
+    }
+
+    ALWAYS_INLINE static size_t index_in_chunk(const TilePoint& position)
+    {
+        return (position.x() % chunk_width) + (chunk_width * (position.y() % chunk_height));
+    }
+
+    const u16 m_width;
+    const u16 m_height;
+    const u16 m_chunks_wide;
+    Vector<Chunk> m_chunks;
+};
+}
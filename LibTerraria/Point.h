@@ -40,6 +40,10 @@ public:
         return {lhs.m_x - rhs.m_x, lhs.m_y - rhs.m_y};
     }
 
+    constexpr bool operator==(const Point<T>& other) const { return m_x == other.m_x && m_y == other.m_y; }
+
+    constexpr bool operator!=(const Point<T>& other) const { return !(*this == other); }
+
 private:
     T m_x{};
     T m_y{};
@@ -47,6 +51,16 @@ private:
 
 using TilePoint = Point<u16>;
 using EntityPoint = Point<float>;
+
+// Entity positions come from clients, who can say they're anywhere at all, including at infinity or not a number.
+// Turning a float like that into an int is undefined, so it's clamped while it's still a float.
+inline int clamp_to_int(float value, int min, int max)
+{
+    if (isnan(value))
+        return min;
+
+    return static_cast<int>(clamp<float>(value, min, max));
+}
 }
 
 template<typename T>
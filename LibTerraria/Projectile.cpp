@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <LibTerraria/Net/Packets/SyncProjectile.h>
+#include <LibTerraria/Projectile.h>
+
+namespace Terraria
+{
+Projectile Projectile::from_packet(const Net::Packets::SyncProjectile& packet)
+{
+    Projectile projectile(packet.id());
+    projectile.position() = packet.position();
+    projectile.velocity() = packet.velocity();
+    projectile.set_owner(packet.owner());
+    projectile.set_type(packet.type());
+    projectile.ai() = packet.ai();
+    projectile.banner_id_to_respond_to() = packet.banner_id_to_respond_to();
+    projectile.damage() = packet.damage();
+    projectile.knockback() = packet.knockback();
+    projectile.original_damage() = packet.original_damage();
+    projectile.uuid() = packet.uuid();
+    return projectile;
+}
+
+Net::Packets::SyncProjectile Projectile::to_packet() const
+{
+    // The flags are worked out from which of these are there when it's written.
+    Net::Packets::SyncProjectile packet;
+    packet.set_id(m_id);
+    packet.position() = m_position;
+    packet.velocity() = m_velocity;
+    packet.set_owner(m_owner);
+    packet.set_type(m_type);
+    packet.ai() = m_ai;
+    packet.banner_id_to_respond_to() = m_banner_id_to_respond_to;
+    packet.damage() = m_damage;
+    packet.knockback() = m_knockback;
+    packet.original_damage() = m_original_damage;
+    packet.uuid() = m_uuid;
+    return packet;
+}
+}
@@ -11,6 +11,11 @@
 #include <AK/String.h>
 #include <LibTerraria/Point.h>
 
+namespace Terraria::Net::Packets
+{
+class SyncProjectile;
+}
+
 namespace Terraria
 {
 class Projectile
@@ -22,6 +27,10 @@ public:
 
     Projectile() = default;
 
+    static Projectile from_packet(const Net::Packets::SyncProjectile&);
+
+    Net::Packets::SyncProjectile to_packet() const;
+
     i16 id() const { return m_id; }
 
     void set_id(i16 value) { m_id = value; }
@@ -54,21 +54,22 @@ Optional<Tile::PackedFrames> Tile::Block::frame_for_block(const Tile& the_tile,
                                                           const Tile& left, const Tile& right)
 {
     // We cannot frame this tile if it's frame is important
-    if (s_tiles[static_cast<int>(the_tile.block()->id())].frame_important)
+    auto id = the_tile.block_id();
+    if (s_tiles[static_cast<int>(id)].frame_important)
         return {};
 
     u8 bits{0};
 
-    if (top.block().has_value() && top.block()->id() == the_tile.block()->id())
+    if (top.has_block() && top.block_id() == id)
         bits |= 0b0000'0001;
 
-    if (bottom.block().has_value() && bottom.block()->id() == the_tile.block()->id())
+    if (bottom.has_block() && bottom.block_id() == id)
         bits |= 0b0000'0010;
 
-    if (left.block().has_value() && left.block()->id() == the_tile.block()->id())
+    if (left.has_block() && left.block_id() == id)
         bits |= 0b0000'0100;
 
-    if (right.block().has_value() && right.block()->id() == the_tile.block()->id())
+    if (right.has_block() && right.block_id() == id)
         bits |= 0b0000'1000;
 
     return frames_for_general_blocks[bits];
@@ -11,6 +11,7 @@
 namespace Terraria
 {
 // This class should contain light and simple members, we're going to have a lot of these.
+// Everything is stored inline with a single set of flags saying what is present, which keeps it at 11 bytes.
 class [[gnu::packed]] Tile
 {
 public:
@@ -688,78 +689,115 @@ public:
         u8 m_shape{};
     };
 
-    Tile(Block block) : m_block(move(block)) {}
+    Tile(const Block& block) { set_block(block); }
 
-    const Optional<Block>& block() const { return m_block; }
+    // Everything below reads and writes the packed fields directly. Block is only a convenient way of passing a whole
+    // block around, it isn't what we store.
+    bool has_block() const { return has_flag(m_has_block_bit); }
 
-    Optional<Block>& block() { return m_block; }
+    Block::Id block_id() const { return static_cast<Block::Id>(m_block_id); }
 
-    const Optional<WallId>& wall_id() const { return m_wall_id; }
+    void set_block_id(Block::Id value) { m_block_id = static_cast<u16>(value); }
 
-    Optional<WallId>& wall_id() { return m_wall_id; }
+    bool has_frames() const { return has_flag(m_has_frames_bit); }
 
-    bool has_red_wire() const { return (m_flags & m_red_wire_bit) == m_red_wire_bit; }
+    i16 frame_x() const { return m_frame_x; }
 
-    bool has_blue_wire() const { return (m_flags & m_blue_wire_bit) == m_blue_wire_bit; }
+    i16 frame_y() const { return m_frame_y; }
 
-    bool has_green_wire() const { return (m_flags & m_green_wire_bit) == m_green_wire_bit; }
-
-    bool has_yellow_wire() const { return (m_flags & m_yellow_wire_bit) == m_yellow_wire_bit; }
-
-    bool has_actuator() const { return (m_flags & m_actuator_bit) == m_actuator_bit; }
+    void set_frames(i16 x, i16 y)
+    {
+        m_frame_x = x;
+        m_frame_y = y;
+        set_flag(m_has_frames_bit, true);
+    }
 
-    bool is_actuated() const { return (m_flags & m_actuated_bit) == m_actuated_bit; }
+    u8 shape() const { return (m_flags & m_shape_bits) >> m_shape_shift; }
 
-    void set_red_wire(bool value)
+    void set_shape(u8 value)
     {
-        if (value)
-            m_flags |= m_red_wire_bit;
-        else
-            m_flags &= ~m_red_wire_bit;
+        m_flags &= ~m_shape_bits;
+        m_flags |= (value << m_shape_shift) & m_shape_bits;
     }
 
-    void set_blue_wire(bool value)
+    Optional<Block> block() const
     {
-        if (value)
-            m_flags |= m_blue_wire_bit;
-        else
-            m_flags &= ~m_blue_wire_bit;
+        if (!has_block())
+            return {};
+
+        auto block = has_frames() ? Block(block_id(), m_frame_x, m_frame_y) : Block(block_id());
+        block.set_shape(shape());
+        return block;
     }
 
-    void set_green_wire(bool value)
+    void set_block(const Block& block)
     {
-        if (value)
-            m_flags |= m_green_wire_bit;
+        m_block_id = static_cast<u16>(block.id());
+        set_flag(m_has_block_bit, true);
+        set_shape(block.shape());
+
+        if (block.frame_x().has_value() || block.frame_y().has_value())
+        {
+            set_frames(block.frame_x().value_or(0), block.frame_y().value_or(0));
+        }
         else
-            m_flags &= ~m_green_wire_bit;
+        {
+            m_frame_x = 0;
+            m_frame_y = 0;
+            set_flag(m_has_frames_bit, false);
+        }
     }
 
-    void set_yellow_wire(bool value)
+    void clear_block()
     {
-        if (value)
-            m_flags |= m_yellow_wire_bit;
-        else
-            m_flags &= ~m_yellow_wire_bit;
+        m_block_id = 0;
+        m_frame_x = 0;
+        m_frame_y = 0;
+        set_flag(m_has_block_bit, false);
+        set_flag(m_has_frames_bit, false);
+        set_shape(0);
     }
 
-    void set_has_actuator(bool value)
+    bool has_wall() const { return has_flag(m_has_wall_bit); }
+
+    Optional<WallId> wall_id() const
     {
-        if (value)
-            m_flags |= m_actuator_bit;
-        else
-            m_flags &= ~m_actuator_bit;
+        if (!has_wall())
+            return {};
+
+        return static_cast<WallId>(m_wall_id);
     }
 
-    void set_is_actuated(bool value)
+    void set_wall_id(Optional<WallId> value)
     {
-        if (value)
-            m_flags |= m_actuated_bit;
-        else
-            m_flags &= ~m_actuated_bit;
+        m_wall_id = value.has_value() ? static_cast<u16>(*value) : 0;
+        set_flag(m_has_wall_bit, value.has_value());
     }
 
-    // FIXME: Magic value
-    // _technically_ don't need the mask as it's at the end and all the other bytes fall off after shifting...
+    bool has_red_wire() const { return has_flag(m_red_wire_bit); }
+
+    bool has_blue_wire() const { return has_flag(m_blue_wire_bit); }
+
+    bool has_green_wire() const { return has_flag(m_green_wire_bit); }
+
+    bool has_yellow_wire() const { return has_flag(m_yellow_wire_bit); }
+
+    bool has_actuator() const { return has_flag(m_actuator_bit); }
+
+    bool is_actuated() const { return has_flag(m_actuated_bit); }
+
+    void set_red_wire(bool value) { set_flag(m_red_wire_bit, value); }
+
+    void set_blue_wire(bool value) { set_flag(m_blue_wire_bit, value); }
+
+    void set_green_wire(bool value) { set_flag(m_green_wire_bit, value); }
+
+    void set_yellow_wire(bool value) { set_flag(m_yellow_wire_bit, value); }
+
+    void set_has_actuator(bool value) { set_flag(m_actuator_bit, value); }
+
+    void set_is_actuated(bool value) { set_flag(m_actuated_bit, value); }
+
     u8 liquid() const { return (m_flags & m_liquid_bits) >> m_liquid_shift; }
 
     void set_liquid(u8 value)
@@ -773,6 +811,14 @@ public:
 
     void set_liquid_amount(u8 value) { m_liquid_amount = value; }
 
+    bool operator==(const Tile& other) const
+    {
+        return m_block_id == other.m_block_id && m_frame_x == other.m_frame_x && m_frame_y == other.m_frame_y &&
+               m_wall_id == other.m_wall_id && m_liquid_amount == other.m_liquid_amount && m_flags == other.m_flags;
+    }
+
+    bool operator!=(const Tile& other) const { return !(*this == other); }
+
     /* ALWAYS_INLINE */ static PackedFrames frames_for_wire(bool top, bool bottom, bool left, bool right);
 
     static constexpr i16 frame_x_for_style(i16 style) { return style * 18; }
@@ -780,19 +826,38 @@ public:
     static constexpr i16 frame_y_for_style(i16 style) { return style * 22; }
 
 private:
-    u8 m_flags{};
+    ALWAYS_INLINE bool has_flag(u16 bit) const { return (m_flags & bit) == bit; }
+
+    ALWAYS_INLINE void set_flag(u16 bit, bool value)
+    {
+        if (value)
+            m_flags |= bit;
+        else
+            m_flags &= ~bit;
+    }
+
+    // Whatever isn't present is kept zeroed, so two tiles that look the same also compare the same byte for byte.
+    u16 m_block_id{};
+    i16 m_frame_x{};
+    i16 m_frame_y{};
+    u16 m_wall_id{};
     u8 m_liquid_amount{};
-    Optional<Block> m_block;
-    Optional<WallId> m_wall_id;
-    // TODO: Liquid
-
-    static constexpr u8 m_red_wire_bit = 0b0000'0001;
-    static constexpr u8 m_blue_wire_bit = 0b0000'0010;
-    static constexpr u8 m_green_wire_bit = 0b0000'0100;
-    static constexpr u8 m_yellow_wire_bit = 0b0000'1000;
-    static constexpr u8 m_actuator_bit = 0b0001'0000;
-    static constexpr u8 m_actuated_bit = 0b0010'0000;
-    static constexpr u8 m_liquid_bits = 0b1100'0000;
-    static constexpr u8 m_liquid_shift = 6;
+    u16 m_flags{};
+
+    static constexpr u16 m_has_block_bit = 0b0000'0000'0000'0001;
+    static constexpr u16 m_has_frames_bit = 0b0000'0000'0000'0010;
+    static constexpr u16 m_has_wall_bit = 0b0000'0000'0000'0100;
+    static constexpr u16 m_red_wire_bit = 0b0000'0000'0000'1000;
+    static constexpr u16 m_blue_wire_bit = 0b0000'0000'0001'0000;
+    static constexpr u16 m_green_wire_bit = 0b0000'0000'0010'0000;
+    static constexpr u16 m_yellow_wire_bit = 0b0000'0000'0100'0000;
+    static constexpr u16 m_actuator_bit = 0b0000'0000'1000'0000;
+    static constexpr u16 m_actuated_bit = 0b0000'0001'0000'0000;
+    static constexpr u16 m_liquid_bits = 0b0000'0110'0000'0000;
+    static constexpr u16 m_liquid_shift = 9;
+    static constexpr u16 m_shape_bits = 0b0011'1000'0000'0000;
+    static constexpr u16 m_shape_shift = 11;
 };
+
+static_assert(sizeof(Tile) == 11);
 }
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <LibTerraria/TileColumnDecoder.h>
+#include <LibTerraria/TileColumnFormat.h>
+
+namespace Terraria
+{
+using namespace TileColumnFormat;
+
+ErrorOr<u16> TileColumnDecoder::decode_tile(Reader& reader, Tile& tile) const
+{
+    u8 header1 = reader.read_u8();
+    u8 header2 = 0;
+    u8 header3 = 0;
+
+    if ((header1 & additional_header_bit) == additional_header_bit)
+    {
+        header2 = reader.read_u8();
+        if ((header2 & additional_header_bit) == additional_header_bit)
+            header3 = reader.read_u8();
+    }
+
+    if ((header1 & block_bit) == block_bit)
+    {
+        u16 block_id = (header1 & extended_block_id_bit) ? reader.read_u16() : reader.read_u8();
+        tile.set_block(Tile::Block(static_cast<Tile::Block::Id>(block_id)));
+
+        if (is_important(block_id))
+        {
+            auto frame_x = static_cast<i16>(reader.read_u16());
+            auto frame_y = static_cast<i16>(reader.read_u16());
+
+            if (tile.block_id() == Tile::Block::Id::Timers)
+                frame_y = 0;
+
+            tile.set_frames(frame_x, frame_y);
+        }
+    }
+
+    // TODO: Do something with this block color
+    if ((header3 & color_bit) == color_bit)
+        reader.skip(1);
+
+    Optional<u8> lower_wall_id;
+    if ((header1 & wall_bit) == wall_bit)
+    {
+        lower_wall_id = reader.read_u8();
+
+        // TODO: Do something with this wall color
+        if ((header3 & wall_color_bit) == wall_color_bit)
+            reader.skip(1);
+    }
+
+    u8 liquid = (header1 & liquid_bits) >> liquid_shift;
+    if (liquid != 0)
+    {
+        tile.set_liquid(liquid);
+        tile.set_liquid_amount(reader.read_u8());
+    }
+
+    if (lower_wall_id.has_value())
+    {
+        if ((header3 & extended_wall_id_bit) == extended_wall_id_bit)
+            tile.set_wall_id(static_cast<Tile::WallId>((reader.read_u8() << 8) | *lower_wall_id));
+        else
+            tile.set_wall_id(static_cast<Tile::WallId>(*lower_wall_id));
+    }
+
+    if (tile.has_block())
+        tile.set_shape((header2 & shape_bits) >> shape_shift);
+
+    if ((header2 & red_wire_bit) == red_wire_bit)
+        tile.set_red_wire(true);
+
+    if ((header2 & blue_wire_bit) == blue_wire_bit)
+        tile.set_blue_wire(true);
+
+    if ((header2 & green_wire_bit) == green_wire_bit)
+        tile.set_green_wire(true);
+
+    if ((header3 & yellow_wire_bit) == yellow_wire_bit)
+        tile.set_yellow_wire(true);
+
+    if ((header3 & actuator_bit) == actuator_bit)
+        tile.set_has_actuator(true);
+
+    if ((header3 & actuated_bit) == actuated_bit)
+        tile.set_is_actuated(true);
+
+    u8 rle_type = (header1 & rle_bits) >> rle_shift;
+    if (rle_type == 1)
+        return reader.read_u8();
+    if (rle_type == 2)
+        return reader.read_u16();
+    if (rle_type != 0)
+        return Error::from_string_literal("Tile has an invalid repeat count type");
+
+    return 0;
+}
+
+ErrorOr<u16> TileColumnDecoder::skip_tile(Reader& reader) const
+{
+    u8 header1 = reader.read_u8();
+    u8 header3 = 0;
+
+    if ((header1 & additional_header_bit) == additional_header_bit)
+    {
+        if ((reader.read_u8() & additional_header_bit) == additional_header_bit)
+            header3 = reader.read_u8();
+    }
+
+    if ((header1 & block_bit) == block_bit)
+    {
+        u16 block_id = (header1 & extended_block_id_bit) ? reader.read_u16() : reader.read_u8();
+        if (is_important(block_id))
+            reader.skip(4);
+    }
+
+    if ((header3 & color_bit) == color_bit)
+        reader.skip(1);
+
+    if ((header1 & wall_bit) == wall_bit)
+    {
+        reader.skip(1);
+
+        if ((header3 & wall_color_bit) == wall_color_bit)
+            reader.skip(1);
+
+        if ((header3 & extended_wall_id_bit) == extended_wall_id_bit)
+            reader.skip(1);
+    }
+
+    if ((header1 & liquid_bits) != 0)
+        reader.skip(1);
+
+    u8 rle_type = (header1 & rle_bits) >> rle_shift;
+    if (rle_type == 1)
+        return reader.read_u8();
+    if (rle_type == 2)
+        return reader.read_u16();
+    if (rle_type != 0)
+        return Error::from_string_literal("Tile has an invalid repeat count type");
+
+    return 0;
+}
+
+ErrorOr<Vector<size_t>> TileColumnDecoder::scan_column_offsets() const
+{
+    Vector<size_t> offsets;
+    offsets.ensure_capacity(m_width + 1);
+
+    Reader reader(m_tiles, 0);
+    for (u16 x = 0; x < m_width; x++)
+    {
+        offsets.append(reader.offset());
+
+        for (u32 y = 0; y < m_height;)
+        {
+            auto repeat = TRY(skip_tile(reader));
+            y += repeat + 1;
+            if (y > m_height)
+                return Error::from_string_literal("Tile repeat count runs past the end of its column");
+        }
+
+        if (reader.has_overrun())
+            return Error::from_string_literal("Tile section ended in the middle of a column");
+    }
+
+    offsets.append(reader.offset());
+    return offsets;
+}
+
+ErrorOr<void> TileColumnDecoder::decode_columns(TileMap& tile_map, u16 first_column, u16 count, size_t offset) const
+{
+    return for_each_tile_run(first_column, count, offset, [&](u16 x, u16 y, u16 length, const Tile& tile) {
+        for (u16 i = 0; i < length; i++)
+            tile_map.set({x, static_cast<u16>(y + i)}, tile);
+    });
+}
+}
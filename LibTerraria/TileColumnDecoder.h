@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Error.h>
+#include <AK/Span.h>
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <LibTerraria/Tile.h>
+#include <LibTerraria/TileMap.h>
+
+namespace Terraria
+{
+// The tile section of a world file is stored column by column, each tile being a few bitmask headers followed by
+// variable length data, optionally with a repeat count for the following tiles in the same column.
+// Nothing here owns the bytes, they must outlive the decoder.
+class TileColumnDecoder
+{
+public:
+    TileColumnDecoder(ReadonlyBytes tiles, u16 width, u16 height, const Vector<bool>& importance)
+        : m_tiles(tiles), m_width(width), m_height(height), m_importance(importance)
+    {
+    }
+
+    u16 width() const { return m_width; }
+
+    u16 height() const { return m_height; }
+
+    // Walks the headers of every tile without decoding them, to find the offset each column starts at.
+    // The returned vector has width() + 1 entries, the last one being the end of the tile section.
+    ErrorOr<Vector<size_t>> scan_column_offsets() const;
+
+    // Decodes columns [first_column, first_column + count), where the first of them starts at offset.
+    ErrorOr<void> decode_columns(TileMap&, u16 first_column, u16 count, size_t offset) const;
+
+    // Same as above, but hands every run of identical tiles to the callback as (x, y, length, tile) instead of writing
+    // them anywhere, with the run going down the column from y.
+    template<typename Callback>
+    ErrorOr<void> for_each_tile_run(u16 first_column, u16 count, size_t offset, Callback callback) const
+    {
+        Reader reader(m_tiles, offset);
+        for (u16 x = first_column; x < first_column + count; x++)
+        {
+            for (u32 y = 0; y < m_height;)
+            {
+                Tile tile;
+                auto repeat = TRY(decode_tile(reader, tile));
+                if (y + repeat >= m_height)
+                    return Error::from_string_literal("Tile repeat count runs past the end of its column");
+
+                callback(x, static_cast<u16>(y), static_cast<u16>(repeat + 1), tile);
+                y += repeat + 1;
+            }
+
+            if (reader.has_overrun())
+                return Error::from_string_literal("Tile section ended in the middle of a column");
+        }
+
+        return {};
+    }
+
+private:
+    // Reading tiles through an InputStream costs a virtual call per byte, and they're tiny. This reads straight from
+    // the bytes instead, and remembers if we ever went past the end so it can be checked once per column.
+    class Reader
+    {
+    public:
+        Reader(ReadonlyBytes bytes, size_t offset) : m_bytes(bytes), m_offset(offset) {}
+
+        size_t offset() const { return m_offset; }
+
+        bool has_overrun() const { return m_overrun; }
+
+        ALWAYS_INLINE u8 read_u8()
+        {
+            if (m_offset >= m_bytes.size())
+            {
+                m_overrun = true;
+                return 0;
+            }
+
+            return m_bytes[m_offset++];
+        }
+
+        ALWAYS_INLINE u16 read_u16()
+        {
+            u16 low = read_u8();
+            return low | (read_u8() << 8);
+        }
+
+        ALWAYS_INLINE void skip(size_t count)
+        {
+            if (m_offset + count > m_bytes.size())
+            {
+                m_overrun = true;
+                m_offset = m_bytes.size();
+                return;
+            }
+
+            m_offset += count;
+        }
+
+    private:
+        ReadonlyBytes m_bytes;
+        size_t m_offset;
+        bool m_overrun{};
+    };
+
+    ErrorOr<u16> decode_tile(Reader&, Tile&) const;
+
+    ErrorOr<u16> skip_tile(Reader&) const;
+
+    bool is_important(u16 block_id) const { return block_id < m_importance.size() && m_importance[block_id]; }
+
+    ReadonlyBytes m_tiles;
+    u16 m_width;
+    u16 m_height;
+    const Vector<bool>& m_importance;
+};
+}
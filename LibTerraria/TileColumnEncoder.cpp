@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/NumericLimits.h>
+#include <LibTerraria/TileColumnEncoder.h>
+#include <LibTerraria/TileColumnFormat.h>
+
+namespace Terraria
+{
+using namespace TileColumnFormat;
+
+ALWAYS_INLINE static void append_u16(Vector<u8>& output, u16 value)
+{
+    output.append(value & 0xFF);
+    output.append(value >> 8);
+}
+
+void TileColumnEncoder::encode_columns(u16 first_column, u16 count, Vector<u8>& output) const
+{
+    auto height = m_tile_map.height();
+
+    // Tile maps are quick to read a row at a time but we need to go a column at a time, so copy a few columns out at
+    // once and walk those instead.
+    static constexpr u16 columns_per_batch = 200;
+    Vector<Tile> tiles;
+
+    for (u16 batch_column = first_column; batch_column < first_column + count; batch_column += columns_per_batch)
+    {
+        u16 batch_width = min(columns_per_batch, first_column + count - batch_column);
+        tiles.clear_with_capacity();
+        tiles.ensure_capacity(batch_width * height);
+        m_tile_map.for_each_in_rect({batch_column, 0}, batch_width, height,
+                                    [&](const Tile& tile) { tiles.unchecked_append(tile); });
+
+        for (u16 x = 0; x < batch_width; x++)
+        {
+            for (u32 y = 0; y < height;)
+            {
+                auto& tile = tiles[x + (batch_width * y)];
+
+                u32 repeat = 0;
+                while (y + repeat + 1 < height && repeat < NumericLimits<u16>::max() &&
+                       tiles[x + (batch_width * (y + repeat + 1))] == tile)
+                    repeat++;
+
+                encode_tile(tile, repeat, output);
+                y += repeat + 1;
+            }
+        }
+    }
+}
+
+void TileColumnEncoder::encode_tile(const Tile& tile, u16 repeat, Vector<u8>& output) const
+{
+    u8 header1 = 0;
+    u8 header2 = 0;
+    u8 header3 = 0;
+
+    u16 block_id = static_cast<u16>(tile.block_id());
+    if (tile.has_block())
+    {
+        header1 |= block_bit;
+        if (block_id > 255)
+            header1 |= extended_block_id_bit;
+
+        header2 |= (tile.shape() << shape_shift) & shape_bits;
+    }
+
+    u16 wall_id = tile.has_wall() ? static_cast<u16>(*tile.wall_id()) : 0;
+    if (tile.has_wall())
+    {
+        header1 |= wall_bit;
+        if (wall_id > 255)
+            header3 |= extended_wall_id_bit;
+    }
+
+    header1 |= (tile.liquid() << liquid_shift) & liquid_bits;
+
+    if (tile.has_red_wire())
+        header2 |= red_wire_bit;
+
+    if (tile.has_blue_wire())
+        header2 |= blue_wire_bit;
+
+    if (tile.has_green_wire())
+        header2 |= green_wire_bit;
+
+    if (tile.has_yellow_wire())
+        header3 |= yellow_wire_bit;
+
+    if (tile.has_actuator())
+        header3 |= actuator_bit;
+
+    if (tile.is_actuated())
+        header3 |= actuated_bit;
+
+    if (repeat > 255)
+        header1 |= (2 << rle_shift);
+    else if (repeat > 0)
+        header1 |= (1 << rle_shift);
+
+    if (header3 != 0)
+        header2 |= additional_header_bit;
+
+    if (header2 != 0)
+        header1 |= additional_header_bit;
+
+    output.append(header1);
+    if (header2 != 0)
+        output.append(header2);
+    if (header3 != 0)
+        output.append(header3);
+
+    if (tile.has_block())
+    {
+        if (block_id > 255)
+            append_u16(output, block_id);
+        else
+            output.append(block_id);
+
+        if (is_important(block_id))
+        {
+            append_u16(output, static_cast<u16>(tile.frame_x()));
+            append_u16(output, static_cast<u16>(tile.frame_y()));
+        }
+    }
+
+    if (tile.has_wall())
+        output.append(wall_id & 0xFF);
+
+    if (tile.liquid() != 0)
+        output.append(tile.liquid_amount());
+
+    if (wall_id > 255)
+        output.append(wall_id >> 8);
+
+    if (repeat > 255)
+        append_u16(output, repeat);
+    else if (repeat > 0)
+        output.append(repeat);
+}
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+#include <AK/Vector.h>
+#include <LibTerraria/Tile.h>
+#include <LibTerraria/TileMap.h>
+
+namespace Terraria
+{
+// The opposite of TileColumnDecoder, writing tiles the way the tile section of a world file stores them.
+// Columns are independent of each other, so any range of them can be encoded on its own and concatenated after.
+class TileColumnEncoder
+{
+public:
+    TileColumnEncoder(const TileMap& tile_map, const Vector<bool>& importance)
+        : m_tile_map(tile_map), m_importance(importance)
+    {
+    }
+
+    // Appends columns [first_column, first_column + count) to output.
+    void encode_columns(u16 first_column, u16 count, Vector<u8>& output) const;
+
+private:
+    void encode_tile(const Tile&, u16 repeat, Vector<u8>& output) const;
+
+    bool is_important(u16 block_id) const { return block_id < m_importance.size() && m_importance[block_id]; }
+
+    const TileMap& m_tile_map;
+    const Vector<bool>& m_importance;
+};
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// The bits of the headers in front of every tile in the tile section of a world file, shared between the decoder and
+// the encoder.
+namespace Terraria::TileColumnFormat
+{
+// Header 1
+static constexpr u8 additional_header_bit = 0b0000'0001;
+static constexpr u8 block_bit = 0b0000'0010;
+static constexpr u8 wall_bit = 0b0000'0100;
+static constexpr u8 liquid_bits = 0b0001'1000;
+static constexpr u8 liquid_shift = 3;
+static constexpr u8 extended_block_id_bit = 0b0010'0000;
+static constexpr u8 rle_bits = 0b1100'0000;
+static constexpr u8 rle_shift = 6;
+
+// Header 2
+static constexpr u8 red_wire_bit = 0b0000'0010;
+static constexpr u8 blue_wire_bit = 0b0000'0100;
+static constexpr u8 green_wire_bit = 0b0000'1000;
+static constexpr u8 shape_bits = 0b0111'0000;
+static constexpr u8 shape_shift = 4;
+
+// Header 3
+static constexpr u8 actuator_bit = 0b0000'0010;
+static constexpr u8 actuated_bit = 0b0000'0100;
+static constexpr u8 color_bit = 0b0000'1000;
+static constexpr u8 wall_color_bit = 0b0001'0000;
+static constexpr u8 yellow_wire_bit = 0b0010'0000;
+static constexpr u8 extended_wall_id_bit = 0b0100'0000;
+}
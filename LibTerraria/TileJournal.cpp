@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Array.h>
+#include <AK/MemoryStream.h>
+#include <AK/NumericLimits.h>
+#include <LibCore/File.h>
+#include <LibTerraria/Model.h>
+#include <LibTerraria/TileJournal.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace Terraria
+{
+ErrorOr<NonnullOwnPtr<TileJournal>> TileJournal::open(String path)
+{
+    int fd = ::open(path.characters(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return Error::from_errno(errno);
+
+    return adopt_own(*new TileJournal(move(path), fd));
+}
+
+TileJournal::TileJournal(String path, int fd)
+    : m_path(move(path)), m_checkpoint_path(String::formatted("{}.old", m_path)), m_fd(fd),
+      m_writer(Threading::Thread::construct([this]() { return write_batches(); }, "Tile journal"sv))
+{
+    m_batches.append({});
+    m_writer->start();
+}
+
+TileJournal::~TileJournal()
+{
+    {
+        Threading::MutexLocker locker(m_mutex);
+        m_stopping = true;
+        m_batches_queued.broadcast();
+    }
+
+    // The writer finishes off whatever is still queued before it stops.
+    (void)m_writer->join();
+    close(m_fd);
+}
+
+void TileJournal::log_tile_modification(const TileModification& modification)
+{
+    Array<u8, 16> buffer;
+    OutputMemoryStream stream(buffer);
+    stream << static_cast<u8>(RecordType::TileModification);
+    stream << modification;
+    queue(stream.bytes());
+}
+
+void TileJournal::log_object_placement(const TilePoint& position, i16 type, i16 style, u8 alternate, i8 random,
+                                       bool direction)
+{
+    Array<u8, 16> buffer;
+    OutputMemoryStream stream(buffer);
+    stream << static_cast<u8>(RecordType::ObjectPlacement);
+    stream << position;
+    stream << type;
+    stream << style;
+    stream << alternate;
+    stream << random;
+    stream << direction;
+    queue(stream.bytes());
+}
+
+void TileJournal::queue(ReadonlyBytes record)
+{
+    VERIFY(record.size() <= NumericLimits<u8>::max());
+    u8 size = record.size();
+
+    Threading::MutexLocker locker(m_mutex);
+    m_batches.last().bytes.append(size);
+    m_batches.last().bytes.append(record.data(), record.size());
+    m_logged_changes++;
+    m_batches_queued.broadcast();
+}
+
+void TileJournal::checkpoint() { finish_batch(AfterBatch::Checkpoint); }
+
+void TileJournal::discard_checkpoint() { finish_batch(AfterBatch::DiscardCheckpoint); }
+
+void TileJournal::finish_batch(AfterBatch after)
+{
+    // Anything logged from now on goes in a new batch, so it ends up on the right side of the checkpoint.
+    Threading::MutexLocker locker(m_mutex);
+    m_batches.last().after = after;
+    m_batches.append({});
+    m_batches_queued.broadcast();
+}
+
+intptr_t TileJournal::write_batches()
+{
+    for (;;)
+    {
+        Vector<Batch> batches;
+        {
+            Threading::MutexLocker locker(m_mutex);
+            while (!m_stopping && m_batches.size() == 1 && m_batches.first().bytes.is_empty())
+                m_batches_queued.wait();
+
+            if (m_stopping && m_batches.size() == 1 && m_batches.first().bytes.is_empty())
+                return 0;
+
+            batches = move(m_batches);
+            m_batches.append({});
+        }
+
+        // Everything that was queued while we were busy with the last lot gets written out and synced in one go.
+        for (auto& batch : batches)
+        {
+            auto batch_start = lseek(m_fd, 0, SEEK_END);
+            for (size_t written = 0; written < batch.bytes.size();)
+            {
+                auto rc = write(m_fd, batch.bytes.data() + written, batch.bytes.size() - written);
+                if (rc < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    // Don't leave half a record behind for everything after it to be appended onto, this batch is
+                    // lost either way.
+                    perror("write");
+                    if (batch_start >= 0 && ftruncate(m_fd, batch_start) < 0)
+                        perror("ftruncate");
+                    break;
+                }
+
+                written += rc;
+            }
+
+            if (!batch.bytes.is_empty() && fdatasync(m_fd) < 0)
+                perror("fdatasync");
+
+            if (batch.after == AfterBatch::Checkpoint)
+            {
+                auto result = write_checkpoint();
+                if (result.is_error())
+                    warnln("Failed to checkpoint the tile journal: {}", result.error());
+            }
+            else if (batch.after == AfterBatch::DiscardCheckpoint)
+            {
+                if (unlink(m_checkpoint_path.characters()) < 0 && errno != ENOENT)
+                    perror("unlink");
+            }
+        }
+
+        m_batches_written++;
+    }
+}
+
+ErrorOr<void> TileJournal::write_checkpoint()
+{
+    // The last save didn't make it, so the changes set aside for it still aren't in any saved world. Keep them, and
+    // add everything since onto the end.
+    if (access(m_checkpoint_path.characters(), F_OK) == 0)
+    {
+        auto file = TRY(Core::File::open(m_path, Core::OpenMode::ReadOnly));
+        auto bytes = file->read_all();
+
+        int checkpoint_fd = ::open(m_checkpoint_path.characters(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (checkpoint_fd < 0)
+            return Error::from_errno(errno);
+
+        for (size_t written = 0; written < bytes.size();)
+        {
+            auto rc = write(checkpoint_fd, bytes.data() + written, bytes.size() - written);
+            if (rc < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                auto error = Error::from_errno(errno);
+                close(checkpoint_fd);
+                return error;
+            }
+
+            written += rc;
+        }
+
+        if (fdatasync(checkpoint_fd) < 0)
+        {
+            auto error = Error::from_errno(errno);
+            close(checkpoint_fd);
+            return error;
+        }
+
+        close(checkpoint_fd);
+
+        if (ftruncate(m_fd, 0) < 0)
+            return Error::from_errno(errno);
+
+        return {};
+    }
+
+    if (rename(m_path.characters(), m_checkpoint_path.characters()) < 0)
+        return Error::from_errno(errno);
+
+    int fd = ::open(m_path.characters(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return Error::from_errno(errno);
+
+    close(m_fd);
+    m_fd = fd;
+    return {};
+}
+
+ErrorOr<size_t> TileJournal::replay(const String& path, TileMap& tile_map)
+{
+    // The changes set aside for a save that never finished came first.
+    size_t replayed = 0;
+    auto checkpoint_path = String::formatted("{}.old", path);
+    if (access(checkpoint_path.characters(), F_OK) == 0)
+        replayed += TRY(replay_file(checkpoint_path, tile_map));
+
+    if (access(path.characters(), F_OK) == 0)
+        replayed += TRY(replay_file(path, tile_map));
+
+    return replayed;
+}
+
+ErrorOr<size_t> TileJournal::replay_file(const String& path, TileMap& tile_map)
+{
+    auto file = TRY(Core::File::open(path, Core::OpenMode::ReadOnly));
+    auto bytes = file->read_all();
+    InputMemoryStream stream(bytes);
+
+    size_t replayed = 0;
+    size_t skipped = 0;
+    size_t good_offset = 0;
+    while (!stream.eof())
+    {
+        u8 size;
+        stream >> size;
+        if (stream.handle_any_error() || stream.remaining() < size)
+            break;
+
+        auto record = bytes.bytes().slice(stream.offset(), size);
+        stream.discard_or_error(size);
+        good_offset = stream.offset();
+
+        if (replay_record(record, tile_map))
+            replayed++;
+        else
+            skipped++;
+    }
+
+    if (skipped > 0)
+        warnln("Tile journal {} has {} changes that don't make sense, skipped them", path, skipped);
+
+    if (good_offset != bytes.size())
+    {
+        warnln("Tile journal {} has {} bytes at the end we can't make sense of, dropping them", path,
+               bytes.size() - good_offset);
+        if (truncate(path.characters(), good_offset) < 0)
+            return Error::from_errno(errno);
+    }
+
+    return replayed;
+}
+
+bool TileJournal::replay_record(ReadonlyBytes record, TileMap& tile_map)
+{
+    if (record.is_empty())
+        return false;
+
+    InputMemoryStream stream(record);
+    u8 type;
+    stream >> type;
+
+    if (type == static_cast<u8>(RecordType::TileModification))
+    {
+        TileModification modification;
+        stream >> modification;
+        if (stream.handle_any_error() || !tile_map.can_process_tile_modification(modification))
+            return false;
+
+        tile_map.process_tile_modification(modification);
+        return true;
+    }
+
+    if (type == static_cast<u8>(RecordType::ObjectPlacement))
+    {
+        TilePoint position;
+        i16 object_type;
+        i16 style;
+        u8 alternate;
+        i8 random;
+        bool direction;
+        stream >> position;
+        stream >> object_type;
+        stream >> style;
+        stream >> alternate;
+        stream >> random;
+        stream >> direction;
+        if (stream.handle_any_error() || object_type < 0 || object_type >= s_total_tile_objects)
+            return false;
+
+        auto& object = s_tile_objects[object_type];
+        if (!tile_map.can_place_object(position, object))
+            return false;
+
+        tile_map.place_object(position, object, style, alternate, random, direction);
+        return true;
+    }
+
+    stream.handle_any_error();
+    return false;
+}
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Error.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Span.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibTerraria/Point.h>
+#include <LibTerraria/TileMap.h>
+#include <LibTerraria/TileModification.h>
+#include <LibThreading/ConditionVariable.h>
+#include <LibThreading/Mutex.h>
+#include <LibThreading/Thread.h>
+
+namespace Terraria
+{
+// An append-only log of every change made to a tile map since the world was last saved, so that a crash only loses
+// whatever hadn't reached the disk yet rather than everything since the last save.
+//
+// Every record starts with its size, so one that doesn't make sense can be skipped over without losing the ones after
+// it. Only changes that are valid for the map should be logged, but replaying checks them again all the same.
+//
+// Changes are queued up by whoever makes them and written out by a thread of its own, which writes everything that
+// was queued while it was busy in one go and syncs it to disk once per batch.
+//
+// Saving goes hand in hand with checkpoints: right as the world is snapshotted, checkpoint() moves everything logged
+// so far aside to <path>.old, which the snapshot already contains. Once the snapshot has been saved,
+// discard_checkpoint() deletes it. If saving fails, the next checkpoint adds onto it instead, so nothing is lost until
+// a save succeeds.
+class TileJournal
+{
+public:
+    static ErrorOr<NonnullOwnPtr<TileJournal>> open(String path);
+
+    // Applies every change in the journal at path (and the one set aside for an unfinished save, if there is one) to
+    // the tile map, in the order they were made, through the same TileMap functions that made them.
+    // A change that was only partially written when we crashed is dropped, and cut off the end of the journal. Changes
+    // that don't fit the map are skipped. Returns how many changes were applied.
+    static ErrorOr<size_t> replay(const String& path, TileMap&);
+
+    ~TileJournal();
+
+    void log_tile_modification(const TileModification&);
+
+    void log_object_placement(const TilePoint& position, i16 type, i16 style, u8 alternate, i8 random,
+                              bool direction);
+
+    void checkpoint();
+
+    void discard_checkpoint();
+
+    u64 logged_changes() const { return m_logged_changes; }
+
+    u64 batches_written() const { return m_batches_written.load(); }
+
+private:
+    enum class RecordType : u8
+    {
+        TileModification,
+        ObjectPlacement
+    };
+
+    // What the writer thread has to do once it has written a batch out.
+    enum class AfterBatch : u8
+    {
+        Nothing,
+        Checkpoint,
+        DiscardCheckpoint
+    };
+
+    struct Batch
+    {
+        Vector<u8> bytes;
+        AfterBatch after{AfterBatch::Nothing};
+    };
+
+    TileJournal(String path, int fd);
+
+    static ErrorOr<size_t> replay_file(const String& path, TileMap&);
+
+    // Returns false if the record doesn't make sense, or doesn't fit the map.
+    static bool replay_record(ReadonlyBytes record, TileMap&);
+
+    void queue(ReadonlyBytes record);
+
+    void finish_batch(AfterBatch);
+
+    intptr_t write_batches();
+
+    ErrorOr<void> write_checkpoint();
+
+    String m_path;
+    String m_checkpoint_path;
+    int m_fd{-1};
+    u64 m_logged_changes{};
+    Atomic<u64> m_batches_written{0};
+
+    Threading::Mutex m_mutex;
+    Threading::ConditionVariable m_batches_queued{m_mutex};
+    Vector<Batch> m_batches;
+    bool m_stopping{false};
+    NonnullRefPtr<Threading::Thread> m_writer;
+};
+}
@@ -12,10 +12,29 @@
 
 namespace Terraria
 {
+bool TileMap::can_process_tile_modification(const Terraria::TileModification& modification) const
+{
+    if (!contains(modification.position))
+        return false;
+
+    switch (modification.action)
+    {
+        case 1:
+        case 21:
+            return modification.flags_1 >= 0 && modification.flags_1 < s_total_tiles;
+        case 3:
+        case 22:
+            return modification.flags_1 >= 0 && modification.flags_1 < s_total_walls;
+        default:
+            return true;
+    }
+}
+
 void TileMap::process_tile_modification(const Terraria::TileModification& modification)
 {
     auto& pos = modification.position;
-    auto& tile = at(pos);
+    // Work on a copy and write it back once we're done, so maps that don't store every tile on its own don't have to.
+    auto tile = static_cast<const TileMap&>(*this).at(pos);
 
     switch (modification.action)
     {
@@ -25,12 +44,12 @@ void TileMap::process_tile_modification(const Terraria::TileModification& modifi
         {
             auto success = !modification.flags_1;
             if (success)
-                tile.block() = {};
+                tile.clear_block();
             else
             {
                 // Picking at grass will remove it's grass
-                if (tile.block()->id() == Tile::Block::Id::Grass)
-                    tile.block()->set_id(Tile::Block::Id::Dirt);
+                if (tile.has_block() && tile.block_id() == Tile::Block::Id::Grass)
+                    tile.set_block_id(Tile::Block::Id::Dirt);
             }
             break;
         }
@@ -39,21 +58,19 @@ void TileMap::process_tile_modification(const Terraria::TileModification& modifi
         {
             auto block_id = static_cast<Terraria::Tile::Block::Id>(modification.flags_1);
             auto style = modification.flags_2;
-            tile.block() = Tile::Block(block_id);
+            tile.set_block(Tile::Block(block_id));
             if (block_id == Tile::Block::Id::Torches)
             {
                 // FIXME: This depends on how the torch is placed! (background/floor, right/left block side, unlit)
                 // Upon further testing, it seems the client just deals with it, because we tell it to re-frame the
                 // section, so it fixes the torch placement... still not correct on our side though!
-                tile.block()->frame_x() = 0;
-                tile.block()->frame_y() = Tile::frame_y_for_style(style);
+                tile.set_frames(0, Tile::frame_y_for_style(style));
             }
             else if (Terraria::s_tiles[(int)block_id].frame_important)
             {
                 // This tile is frame important, and the flags may tell us what the frame x or frame y should be
                 // But we don't handle those cases yet, so just zero them.
-                tile.block()->frame_x() = 0;
-                tile.block()->frame_y() = 0;
+                tile.set_frames(0, 0);
             }
             break;
         }
@@ -61,12 +78,12 @@ void TileMap::process_tile_modification(const Terraria::TileModification& modifi
         {
             auto success = !modification.flags_1;
             if (success)
-                tile.wall_id() = {};
+                tile.set_wall_id({});
             break;
         }
         case 3:
         case 22:
-            tile.wall_id() = static_cast<Terraria::Tile::WallId>(modification.flags_1);
+            tile.set_wall_id(static_cast<Terraria::Tile::WallId>(modification.flags_1));
             break;
         case 5:
             tile.set_red_wire(true);
@@ -75,7 +92,7 @@ void TileMap::process_tile_modification(const Terraria::TileModification& modifi
             tile.set_red_wire(false);
             break;
         case 7:
-            tile.block()->set_shape(1);
+            tile.set_shape(1);
             dbgln_if(SLOPE_DEBUG, "Tile modify 7 with {}, we set the shape to 1", modification.flags_1);
             break;
         case 8:
@@ -99,7 +116,7 @@ void TileMap::process_tile_modification(const Terraria::TileModification& modifi
         case 14:
         {
             auto shape = modification.flags_1 == 0 ? 0 : modification.flags_1 + 1;
-            tile.block()->set_shape(shape);
+            tile.set_shape(shape);
             dbgln_if(SLOPE_DEBUG, "Tile modify 14 with {}, we set the shape to {}", modification.flags_1, shape);
         }
         break;
@@ -111,7 +128,19 @@ void TileMap::process_tile_modification(const Terraria::TileModification& modifi
             break;
         default:
             dbgln("We are not handling tile modification action {}!", modification.action);
+            return;
     }
+
+    set(pos, tile);
+}
+
+bool TileMap::can_place_object(const TilePoint& position, const Model::TileObject& object) const
+{
+    if (position.x() < object.origin.x() || position.y() < object.origin.y())
+        return false;
+
+    auto root = position - object.origin;
+    return root.x() + object.width <= width() && root.y() + object.height <= height();
 }
 
 void TileMap::place_object(const TilePoint& position, const Model::TileObject& object, i16 style, u8 alternate,
@@ -155,9 +184,8 @@ void TileMap::place_object(const TilePoint& position, const Model::TileObject& o
         for (auto y = 0; y < object.height; y++)
         {
             // TODO: Break tiles as necessary
-            auto& tile = at(root.x() + x, root.y() + y) = Tile(Tile::Block(static_cast<Tile::Block::Id>(object.type)));
-            tile.block()->frame_x() = frame_x;
-            tile.block()->frame_y() = frame_y;
+            set({static_cast<u16>(root.x() + x), static_cast<u16>(root.y() + y)},
+                Tile(Tile::Block(static_cast<Tile::Block::Id>(object.type), frame_x, frame_y)));
 
             frame_y += object.coordinate_heights[y] + object.coordinate_padding;
         }
@@ -7,7 +7,9 @@
 #pragma once
 
 #include <AK/Array.h>
+#include <AK/NonnullRefPtr.h>
 #include <AK/RefCounted.h>
+#include <AK/Span.h>
 #include <AK/Types.h>
 #include <LibTerraria/Model.h>
 #include <LibTerraria/Point.h>
@@ -23,20 +25,58 @@ public:
 
     virtual u16 height() const = 0;
 
-    virtual const Tile& at(const TilePoint& position) const = 0;
+    // Tiles might not be stored anywhere a reference would stay valid, like a palette that grows as tiles are set, so
+    // reading one gives back a copy.
+    virtual Tile at(const TilePoint& position) const = 0;
 
     virtual Tile& at(const TilePoint& position) = 0;
 
     ALWAYS_INLINE Tile& at(u16 x, u16 y) { return at({x, y}); }
 
-    ALWAYS_INLINE const Tile& at(u16 x, u16 y) const { return at({x, y}); }
+    ALWAYS_INLINE Tile at(u16 x, u16 y) const { return at({x, y}); }
 
-    virtual const Span<const Tile> tiles() const = 0;
+    // The tiles from start going right along its row, up to max_length of them, for as long as they're laid out next to
+    // each other in memory. This is never empty, but may be as short as a single tile. It's only good until the next
+    // time the map is changed.
+    virtual Span<const Tile> row_span(const TilePoint& start, u16 max_length) const = 0;
 
-    virtual Span<Tile> tiles() = 0;
+    // Calls back with every tile in the rect, row by row. This only makes a virtual call per row_span() rather than
+    // per tile, so it's what anything reading more than a handful of tiles should use.
+    template<typename Callback>
+    void for_each_in_rect(const TilePoint& origin, u16 width, u16 height, Callback callback) const
+    {
+        VERIFY(origin.x() + width <= this->width() && origin.y() + height <= this->height());
+        for (u16 y = origin.y(); y < origin.y() + height; y++)
+        {
+            for (u16 x = 0; x < width;)
+            {
+                auto span = row_span({static_cast<u16>(origin.x() + x), y}, width - x);
+                for (auto& tile : span)
+                    callback(tile);
+                x += span.size();
+            }
+        }
+    }
+
+    // Overwrites a single tile. Maps that don't keep every tile on its own (see PalettedTileMap) can do this more
+    // cheaply than handing out a reference through at(), so prefer it when the whole tile is being replaced.
+    virtual void set(const TilePoint& position, const Tile& tile) { at(position) = tile; }
+
+    // A copy of the map as it is right now, that won't see any changes made to this one afterwards.
+    // This is meant to be safe to read from another thread while this one keeps being written to.
+    virtual NonnullRefPtr<TileMap> snapshot() const = 0;
+
+    bool contains(const TilePoint& position) const { return position.x() < width() && position.y() < height(); }
+
+    // Whether the modification could be applied to this map. Modifications come straight from clients, so this has to
+    // be checked before they're processed.
+    bool can_process_tile_modification(const Terraria::TileModification&) const;
 
     virtual void process_tile_modification(const Terraria::TileModification&);
 
+    // Whether the whole object would fit in the map when placed at this position.
+    bool can_place_object(const Terraria::TilePoint& position, const Terraria::Model::TileObject&) const;
+
     virtual void place_object(const Terraria::TilePoint& position, const Terraria::Model::TileObject&, i16 style,
                               u8 alternate, i8 random, bool direction);
 
@@ -55,17 +95,30 @@ public:
 
     u16 height() const override { return m_height; }
 
-    const Tile& at(const TilePoint& position) const override { return m_tiles.at(index_for_position(position)); }
+    Tile at(const TilePoint& position) const override { return m_tiles.at(index_for_position(position)); }
 
     Tile& at(const TilePoint& position) override { return m_tiles.at(index_for_position(position)); }
 
     ALWAYS_INLINE Tile& at(u16 x, u16 y) { return at({x, y}); }
 
-    ALWAYS_INLINE const Tile& at(u16 x, u16 y) const { return at({x, y}); }
+    ALWAYS_INLINE Tile at(u16 x, u16 y) const { return at({x, y}); }
+
+    Span<const Tile> row_span(const TilePoint& start, u16 max_length) const override
+    {
+        VERIFY(start.x() < m_width && start.y() < m_height);
+        return m_tiles.span().slice(index_for_position(start), min<size_t>(max_length, m_width - start.x()));
+    }
+
+    NonnullRefPtr<TileMap> snapshot() const override
+    {
+        auto copy = adopt_ref(*new MemoryTileMap(m_width, m_height));
+        m_tiles.span().copy_to(copy->m_tiles.span());
+        return copy;
+    }
 
-    const Span<const Tile> tiles() const override { return m_tiles.span(); }
+    const Span<const Tile> tiles() const { return m_tiles.span(); }
 
-    Span<Tile> tiles() override { return m_tiles.span(); }
+    Span<Tile> tiles() { return m_tiles.span(); }
 
 private:
     const u16 m_width;
@@ -4,29 +4,20 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include <AK/Hex.h>
+#include <AK/MemoryStream.h>
+#include <AK/QuickSort.h>
+#include <LibTerraria/ChunkedTileMap.h>
+#include <LibTerraria/LazyTileMap.h>
 #include <LibTerraria/Net/Types.h>
+#include <LibTerraria/PalettedTileMap.h>
+#include <LibTerraria/TileColumnDecoder.h>
+#include <LibTerraria/TileColumnEncoder.h>
 #include <LibTerraria/World.h>
-
-static constexpr u8 additional_header_bit = 0b0000'0001;
-static constexpr u8 block_bit = 0b0000'0010;
-static constexpr u8 wall_bit = 0b0000'0100;
-static constexpr u8 color_bit = 0b0000'1000;
-static constexpr u8 extended_block_id_bit = 0b0010'0000;
-
-static constexpr u8 red_wire_bit = 0b0000'0010;
-static constexpr u8 blue_wire_bit = 0b0000'0100;
-static constexpr u8 green_wire_bit = 0b0000'1000;
-static constexpr u8 wall_color_bit = 0b0001'0000;
-static constexpr u8 liquid_bits = 0b0001'1000;
-static constexpr u8 liquid_shift = 3;
-
-static constexpr u8 rle_bits = 0b1100'0000;
-static constexpr u8 rle_shift = 6;
-
-static constexpr u8 m_actuator_bit = 0b0000'0010;
-static constexpr u8 m_actuated_bit = 0b0000'0100;
-static constexpr u8 yellow_wire_bit = 0b0010'0000;
-static constexpr u8 extended_wall_id_bit = 0b0100'0000;
+#include <LibThreading/Thread.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
 
 template<typename T, size_t size>
 InputStream& operator>>(InputStream& stream, Array<T, size>& array)
@@ -36,12 +27,424 @@ InputStream& operator>>(InputStream& stream, Array<T, size>& array)
     return stream;
 }
 
+template<typename T, size_t size>
+OutputStream& operator<<(OutputStream& stream, const Array<T, size>& array)
+{
+    for (auto i = 0; i < size; i++)
+        stream << array[i];
+    return stream;
+}
+
 namespace Terraria
 {
+static constexpr size_t tiles_section = 1;
+static constexpr size_t chests_section = 2;
+static constexpr size_t signs_section = 3;
+
+static ErrorOr<HashMap<u16, Chest>> read_chests(ReadonlyBytes bytes)
+{
+    InputMemoryStream stream(bytes);
+    HashMap<u16, Chest> chests;
+
+    u8 temporary_8;
+    u16 temporary_16;
+    u32 temporary_32;
+
+    u16 total_chests;
+    stream >> total_chests;
+    u16 items_slots_in_chests;
+    stream >> items_slots_in_chests;
+
+    for (auto i = 0; i < total_chests; i++)
+    {
+        Chest chest;
+        stream >> temporary_32;
+        chest.position().set_x(temporary_32);
+
+        stream >> temporary_32;
+        chest.position().set_y(temporary_32);
+
+        String name;
+        Net::Types::read_string(stream, name);
+        chest.set_name(move(name));
+
+        for (auto j = 0; j < items_slots_in_chests; j++)
+        {
+            stream >> temporary_16;
+            if (temporary_16 == 0)
+                continue;
+
+            Item item;
+            item.set_stack(temporary_16);
+
+            int item_id;
+            stream >> item_id;
+            item.set_id(static_cast<Item::Id>(item_id));
+
+            stream >> temporary_8;
+            item.set_prefix(static_cast<Item::Prefix>(temporary_8));
+
+            chest.contents().set(j, move(item));
+        }
+
+        chests.set(i, move(chest));
+    }
+
+    if (stream.handle_any_error())
+        return Error::from_string_literal("Unable to read world chests");
+
+    return chests;
+}
+
+static ErrorOr<HashMap<u16, Sign>> read_signs(ReadonlyBytes bytes)
+{
+    InputMemoryStream stream(bytes);
+    HashMap<u16, Sign> signs;
+
+    u32 temporary_32;
+
+    u16 total_signs;
+    stream >> total_signs;
+
+    for (auto i = 0; i < total_signs; i++)
+    {
+        Sign sign;
+        String text;
+        Net::Types::read_string(stream, text);
+        sign.set_text(move(text));
+
+        stream >> temporary_32;
+        sign.position().set_x(temporary_32);
+        stream >> temporary_32;
+        sign.position().set_y(temporary_32);
+
+        signs.set(i, move(sign));
+    }
+
+    if (stream.handle_any_error())
+        return Error::from_string_literal("Unable to read world signs");
+
+    return signs;
+}
+
+static ErrorOr<void> decode_tiles(TileMap& tile_map, ReadonlyBytes bytes, const Vector<bool>& importance)
+{
+    TileColumnDecoder decoder(bytes, tile_map.width(), tile_map.height(), importance);
+
+    // Finding where each column starts is much cheaper than decoding it, and once we know we can hand out ranges of
+    // columns to as many threads as we have. The ranges are kept to whole sections, so that no two threads ever touch
+    // the same section of the tile map.
+    auto column_offsets = TRY(decoder.scan_column_offsets());
+    if (column_offsets.last() != bytes.size())
+        dbgln("Tile section is {} bytes, but we only decoded {} bytes of it", bytes.size(), column_offsets.last());
+
+    static constexpr u16 columns_per_section = 200;
+    auto total_sections = (tile_map.width() + columns_per_section - 1) / columns_per_section;
+    auto thread_count = clamp<long>(sysconf(_SC_NPROCESSORS_ONLN), 1, total_sections);
+    auto sections_per_thread = (total_sections + thread_count - 1) / thread_count;
+
+    Vector<NonnullRefPtr<Threading::Thread>> threads;
+    Vector<Optional<Error>> errors;
+    errors.resize(thread_count);
+
+    for (auto i = 0; i < thread_count; i++)
+    {
+        u16 first_column = min(i * sections_per_thread * columns_per_section, tile_map.width());
+        u16 last_column = min((i + 1) * sections_per_thread * columns_per_section, tile_map.width());
+        if (first_column == last_column)
+            break;
+
+        auto thread = Threading::Thread::construct(
+            [&, i, first_column, last_column]() -> intptr_t {
+                auto result = decoder.decode_columns(tile_map, first_column, last_column - first_column,
+                                                     column_offsets[first_column]);
+                if (result.is_error())
+                    errors[i] = result.release_error();
+                return 0;
+            },
+            "World tiles"sv);
+        thread->start();
+        threads.append(move(thread));
+    }
+
+    for (auto& thread : threads)
+        (void)thread->join();
+
+    for (auto& error : errors)
+    {
+        if (error.has_value())
+            return error.release_value();
+    }
+
+    return {};
+}
+
+static void write_chests(OutputStream& stream, const HashMap<u16, Chest>& chests)
+{
+    static constexpr u16 item_slots_in_chests = 40;
+
+    // Chests are keyed by the order they were read in, keep that order.
+    auto indices = chests.keys();
+    quick_sort(indices);
+
+    stream << static_cast<u16>(indices.size());
+    stream << item_slots_in_chests;
+
+    for (auto index : indices)
+    {
+        auto& chest = chests.find(index)->value;
+        stream << static_cast<i32>(chest.position().x());
+        stream << static_cast<i32>(chest.position().y());
+        Net::Types::write_string(stream, chest.name());
+
+        for (u16 slot = 0; slot < item_slots_in_chests; slot++)
+        {
+            auto item = chest.contents().get(slot);
+            if (!item.has_value() || item->stack() == 0)
+            {
+                stream << static_cast<i16>(0);
+                continue;
+            }
+
+            stream << item->stack();
+            stream << static_cast<i32>(item->id());
+            stream << static_cast<u8>(item->prefix());
+        }
+    }
+}
+
+static void write_signs(OutputStream& stream, const HashMap<u16, Sign>& signs)
+{
+    auto indices = signs.keys();
+    quick_sort(indices);
+
+    stream << static_cast<u16>(indices.size());
+
+    for (auto index : indices)
+    {
+        auto& sign = signs.find(index)->value;
+        Net::Types::write_string(stream, sign.text());
+        stream << static_cast<i32>(sign.position().x());
+        stream << static_cast<i32>(sign.position().y());
+    }
+}
+
+static ErrorOr<void> write_header(OutputStream& stream, const World::Header& header, u16 kill_count_length)
+{
+    // UUID doesn't hand out its bytes, but its string form is exactly those bytes in hex.
+    auto uuid_bytes = TRY(decode_hex(header.uuid.to_string().replace("-", "", true)));
+
+    Net::Types::write_string(stream, header.name);
+    Net::Types::write_string(stream, header.seed);
+    stream << header.generator_version;
+
+    stream.write_or_error(uuid_bytes);
+
+    stream << header.id;
+    stream << header.left;
+    stream << header.right;
+    stream << header.top;
+    stream << header.bottom;
+    stream << header.max_tiles_y;
+    stream << header.max_tiles_x;
+    stream << header.game_mode;
+    stream << header.drunk;
+    stream << header.get_good_world;
+    stream << header.tenth_anniversary;
+    stream << header.dont_starve;
+    stream << header.not_the_bees;
+    stream << header.creation_time;
+    stream << header.moon_type;
+    stream << header.tree_x;
+    stream << header.tree_style;
+    stream << header.cave_back_x;
+    stream << header.cave_back_style;
+    stream << header.ice_back_style;
+    stream << header.jungle_back_style;
+    stream << header.hell_back_style;
+    stream << header.spawn_tile;
+    stream << header.surface;
+    stream << header.rock_layer;
+    stream << header.time;
+    stream << header.day_time;
+    stream << header.moon_phase;
+    stream << header.blood_moon;
+    stream << header.eclipse;
+    stream << header.dungeon;
+    stream << header.crimson;
+    stream << header.downed_boss_1;
+    stream << header.downed_boss_2;
+    stream << header.downed_boss_3;
+    stream << header.downed_queen_bee;
+    stream << header.downed_mech_boss_1;
+    stream << header.downed_mech_boss_2;
+    stream << header.downed_mech_boss_3;
+    stream << header.downed_any_mech_boss;
+    stream << header.downed_plantera;
+    stream << header.downed_golem;
+    stream << header.downed_king_slime;
+    stream << header.saved_goblin;
+    stream << header.saved_wizard;
+    stream << header.saved_mech;
+    stream << header.downed_goblins;
+    stream << header.downed_clown;
+    stream << header.downed_frost;
+    stream << header.downed_pirates;
+    stream << header.shadow_orb_smashed;
+    stream << header.spawn_meteor;
+    stream << header.shadow_orb_count;
+    stream << header.altar_count;
+    stream << header.hard_mode;
+    stream << header.invasion_delay;
+    stream << header.invasion_size;
+    stream << header.invasion_type;
+    stream << header.invasion_x;
+    stream << header.slime_rain_time;
+    stream << header.sundial_cooldown;
+    stream << header.raining;
+    stream << header.rain_time;
+    stream << header.max_rain;
+    stream << header.cobalt_tier;
+    stream << header.mythril_tier;
+    stream << header.adamantite_tier;
+    stream << header.backgrounds;
+    stream << header.cloud_background_active;
+    stream << header.number_of_clouds;
+    stream << header.wind_speed_target;
+
+    stream << static_cast<u32>(header.angler_who_finished_today.size());
+    for (auto& name : header.angler_who_finished_today)
+        Net::Types::write_string(stream, name);
+
+    stream << header.saved_angler;
+    stream << header.angler_quest;
+    stream << header.saved_stylist;
+    stream << header.saved_tax_collector;
+    stream << header.saved_golfer;
+    stream << header.invasion_size_start;
+    stream << header.cultist_delay;
+
+    stream << kill_count_length;
+    for (u16 i = 0; i < kill_count_length; i++)
+        stream << header.kill_count.get(static_cast<i16>(i)).value_or(0);
+
+    stream << header.fast_foward_time;
+    stream << header.downed_fishron;
+    stream << header.downed_martians;
+    stream << header.downed_ancient_cultists;
+    stream << header.downed_moonlord;
+    stream << header.downed_halloween_king;
+    stream << header.downed_halloween_tree;
+    stream << header.downed_christmas_ice_queen;
+    stream << header.downed_christmas_santank;
+    stream << header.downed_christmas_tree;
+    stream << header.downed_tower_solar;
+    stream << header.downed_tower_vortex;
+    stream << header.downed_tower_nebula;
+    stream << header.downed_tower_stardust;
+    stream << header.tower_active_solar;
+    stream << header.tower_active_vortex;
+    stream << header.tower_active_nebula;
+    stream << header.tower_active_stardust;
+    stream << header.lunar_apocalypse;
+    stream << header.party_manual;
+    stream << header.party_genuine;
+    stream << header.party_cooldown;
+
+    stream << static_cast<u32>(header.celebrating_npcs.size());
+    for (auto value : header.celebrating_npcs)
+        stream << value;
+
+    stream << header.sandstorming;
+    stream << header.sandstorm_time_left;
+    stream << header.sandstorm_severity;
+    stream << header.sandstorm_intended_severity;
+    stream << header.saved_bartender;
+    stream << header.downed_dd2_1;
+    stream << header.downed_dd2_2;
+    stream << header.downed_dd2_3;
+    stream << header.additional_backgrounds;
+    stream << header.combat_book_was_used;
+    stream << header.lantern_night_cooldown;
+    stream << header.lantern_night_genuine;
+    stream << header.lantern_night_manual;
+    stream << header.lantern_night_next_is_genuine;
+
+    stream << static_cast<u32>(header.tree_tops.size());
+    for (auto value : header.tree_tops)
+        stream << value;
+
+    stream << header.force_halloween_for_today;
+    stream << header.force_christmas_for_today;
+    stream << header.copper_tier;
+    stream << header.iron_tier;
+    stream << header.silver_tier;
+    stream << header.gold_tier;
+    stream << header.bought_cat;
+    stream << header.bought_dog;
+    stream << header.bought_bunny;
+    stream << header.downed_empress_of_light;
+    stream << header.downed_queen_slime;
+
+    return {};
+}
+
+static Vector<Vector<u8>> encode_tiles(const TileMap& tile_map, const Vector<bool>& importance)
+{
+    TileColumnEncoder encoder(tile_map, importance);
+
+    // Same as decoding, every thread takes a range of whole sections. Each writes into its own buffer, and as columns
+    // don't depend on each other, the buffers just have to be written out one after the other.
+    static constexpr u16 columns_per_section = 200;
+    auto total_sections = (tile_map.width() + columns_per_section - 1) / columns_per_section;
+    auto thread_count = clamp<long>(sysconf(_SC_NPROCESSORS_ONLN), 1, total_sections);
+    auto sections_per_thread = (total_sections + thread_count - 1) / thread_count;
+
+    Vector<NonnullRefPtr<Threading::Thread>> threads;
+    Vector<Vector<u8>> buffers;
+    buffers.resize(thread_count);
+
+    for (auto i = 0; i < thread_count; i++)
+    {
+        u16 first_column = min(i * sections_per_thread * columns_per_section, tile_map.width());
+        u16 last_column = min((i + 1) * sections_per_thread * columns_per_section, tile_map.width());
+        if (first_column == last_column)
+            break;
+
+        auto thread = Threading::Thread::construct(
+            [&, i, first_column, last_column]() -> intptr_t {
+                encoder.encode_columns(first_column, last_column - first_column, buffers[i]);
+                return 0;
+            },
+            "World tiles"sv);
+        thread->start();
+        threads.append(move(thread));
+    }
+
+    for (auto& thread : threads)
+        (void)thread->join();
+
+    return buffers;
+}
+
 World::World(NonnullRefPtr<TileMap> tile_map) : m_tile_map(move(tile_map)) {}
 
-ErrorOr<NonnullRefPtr<World>> World::try_load_world(InputStream& stream)
+ErrorOr<NonnullRefPtr<World>> World::try_load_world(ReadonlyBytes bytes, TileStorage tile_storage)
+{
+    return load_world(bytes, tile_storage, {});
+}
+
+ErrorOr<NonnullRefPtr<World>> World::try_load_world_lazily(NonnullRefPtr<Core::MappedFile> mapped_file)
+{
+    auto bytes = mapped_file->bytes();
+    return load_world(bytes, TileStorage::Memory, move(mapped_file));
+}
+
+ErrorOr<NonnullRefPtr<World>> World::load_world(ReadonlyBytes bytes, TileStorage tile_storage,
+                                                RefPtr<Core::MappedFile> lazy_tile_source)
 {
+    InputMemoryStream stream(bytes);
+
     i32 version;
     FileMetadata metadata;
     Header header;
@@ -62,13 +465,23 @@ ErrorOr<NonnullRefPtr<World>> World::try_load_world(InputStream& stream)
     u16 temporary_16;
     u32 temporary_32;
 
-    // TODO: Verify stream against these pointers
     stream >> temporary_16;
     Vector<i32> file_pointers;
     file_pointers.resize(temporary_16);
     for (auto i = 0; i < temporary_16; i++)
         stream >> file_pointers[i];
 
+    // We need to know where each section we read starts, and where the one after it starts to know where it ends.
+    if (file_pointers.size() <= signs_section + 1)
+        return Error::from_string_literal("World is missing section pointers");
+
+    for (size_t i = 0; i <= signs_section + 1; i++)
+    {
+        if (file_pointers[i] < 0 || static_cast<size_t>(file_pointers[i]) > bytes.size() ||
+            (i > 0 && file_pointers[i] < file_pointers[i - 1]))
+            return Error::from_string_literal("World has an invalid section pointer");
+    }
+
     stream >> temporary_16;
     Vector<bool> importance;
     importance.resize(temporary_16);
@@ -112,8 +525,8 @@ ErrorOr<NonnullRefPtr<World>> World::try_load_world(InputStream& stream)
     stream >> header.drunk;
     stream >> header.get_good_world;
     stream >> header.tenth_anniversary;
-    stream >> header.tenth_anniversary;
     stream >> header.dont_starve;
+    stream >> header.not_the_bees;
     stream >> header.creation_time;
     stream >> header.moon_type;
     stream >> header.tree_x;
@@ -190,6 +603,8 @@ ErrorOr<NonnullRefPtr<World>> World::try_load_world(InputStream& stream)
     stream >> header.cultist_delay;
 
     stream >> temporary_16;
+    // Only the kills that aren't zero are kept, so we need to know how many there were to be able to save them back.
+    u16 kill_count_length = temporary_16;
     for (int i = 0; i < temporary_16; i++)
     {
         i32 value;
@@ -264,198 +679,264 @@ ErrorOr<NonnullRefPtr<World>> World::try_load_world(InputStream& stream)
     stream >> header.downed_empress_of_light;
     stream >> header.downed_queen_slime;
 
-    auto tile_map = adopt_ref(*new MemoryTileMap(header.max_tiles_x, header.max_tiles_y));
-    auto world = adopt_ref(*new World(move(tile_map)));
-    world->m_header = move(header);
+    if (stream.handle_any_error())
+        return Error::from_string_literal("Unable to read world header");
 
-    u8 temporary_8;
+    if (header.max_tiles_x <= 0 || header.max_tiles_y <= 0 || header.max_tiles_x > NumericLimits<u16>::max() ||
+        header.max_tiles_y > NumericLimits<u16>::max())
+        return Error::from_string_literal("World has invalid dimensions");
 
-    i16 rle = 0;
-    Tile* tile_to_rle;
-    for (u16 x = 0; x < world->m_header.max_tiles_x; x++)
+    // The header should end exactly where the tiles begin, anything in between is data we don't know about yet.
+    // Whatever that is, it's kept as it is so saving doesn't lose it.
+    Vector<u8> unparsed_header;
+    if (stream.offset() != static_cast<size_t>(file_pointers[tiles_section]))
     {
-        for (u16 y = 0; y < world->m_header.max_tiles_y; y++)
-        {
-            auto& tile = world->m_tile_map->at(x, y);
-
-            if (rle > 0)
-            {
-                tile = *tile_to_rle;
+        dbgln("World header ended at {}, but the tile section starts at {}", stream.offset(),
+              file_pointers[tiles_section]);
 
-                rle--;
-                continue;
-            }
-
-            Optional<u8> lower_wall_id;
-
-            u8 header1;
-            u8 header2 = 0;
-            u8 header3 = 0;
-            stream >> header1;
-
-            if ((header1 & additional_header_bit) == additional_header_bit)
-            {
-                stream >> header2;
-                if ((header2 & additional_header_bit) == additional_header_bit)
-                    stream >> header3;
-            }
-
-            if ((header1 & block_bit) == block_bit)
-            {
-                if ((header1 & extended_block_id_bit))
-                {
-                    stream >> temporary_16;
-                    tile.block() = Tile::Block(static_cast<Tile::Block::Id>(temporary_16));
-                }
-                else
-                {
-                    stream >> temporary_8;
-                    tile.block() = Tile::Block(static_cast<Tile::Block::Id>(temporary_8));
-                }
-
-                if (importance[static_cast<i16>(tile.block()->id())])
-                {
-                    stream >> tile.block()->frame_x();
-                    stream >> tile.block()->frame_y();
-
-                    if (tile.block()->id() == Tile::Block::Id::Timers)
-                        tile.block()->frame_y() = 0;
-                }
-            }
+        if (stream.offset() < static_cast<size_t>(file_pointers[tiles_section]))
+        {
+            auto unparsed = bytes.slice(stream.offset(), file_pointers[tiles_section] - stream.offset());
+            unparsed_header.append(unparsed.data(), unparsed.size());
+        }
+    }
 
-            if ((header3 & color_bit) == color_bit)
-            {
-                // TODO: Do something with this block color
-                stream >> temporary_8;
-            }
+    auto section_bytes = [&](size_t section) {
+        return bytes.slice(file_pointers[section], file_pointers[section + 1] - file_pointers[section]);
+    };
 
-            if ((header1 & wall_bit) == wall_bit)
-            {
-                stream >> lower_wall_id;
+    // We don't understand anything past the signs yet, so it's kept as it is to be written back out when saving.
+    // Where each of those sections start is kept relative to the first one, as everything before them may change size.
+    Vector<u8> trailing_sections;
+    Vector<i32> trailing_section_offsets;
+    {
+        auto first_trailing_section = file_pointers[signs_section + 1];
+        auto trailing = bytes.slice(first_trailing_section);
+        trailing_sections.append(trailing.data(), trailing.size());
+        for (size_t i = signs_section + 1; i < file_pointers.size(); i++)
+            trailing_section_offsets.append(file_pointers[i] - first_trailing_section);
+    }
 
-                // TODO: Do something with this wall color
-                if ((header3 & wall_color_bit) == wall_color_bit)
-                    stream >> temporary_8;
-            }
+    // Keep our own copy around for saving, as the lazy tile map takes the one we have.
+    auto world_importance = importance;
 
-            temporary_8 = ((header1 & liquid_bits) >> liquid_shift);
-            if (temporary_8 != 0)
-            {
-                tile.set_liquid(temporary_8);
-                stream >> temporary_8;
-                tile.set_liquid_amount(temporary_8);
-            }
+    RefPtr<TileMap> tile_map;
+    RefPtr<LazyTileMap> lazy_tile_map;
+    if (lazy_tile_source)
+    {
+        auto tiles = section_bytes(tiles_section);
+        TileColumnDecoder decoder(tiles, header.max_tiles_x, header.max_tiles_y, importance);
+        auto column_offsets = TRY(decoder.scan_column_offsets());
+        lazy_tile_map = adopt_ref(*new LazyTileMap(lazy_tile_source.release_nonnull(), tiles, header.max_tiles_x,
+                                                   header.max_tiles_y, move(importance), move(column_offsets)));
+        tile_map = lazy_tile_map;
+    }
+    else if (tile_storage == TileStorage::Chunked)
+        tile_map = adopt_ref(*new ChunkedTileMap(header.max_tiles_x, header.max_tiles_y));
+    else if (tile_storage == TileStorage::Paletted)
+        tile_map = adopt_ref(*new PalettedTileMap(header.max_tiles_x, header.max_tiles_y));
+    else
+        tile_map = adopt_ref(*new MemoryTileMap(header.max_tiles_x, header.max_tiles_y));
+
+    auto world = adopt_ref(*new World(tile_map.release_nonnull()));
+    world->m_version = version;
+    world->m_metadata = metadata;
+    world->m_header = move(header);
+    world->m_importance = move(world_importance);
+    world->m_kill_count_length = kill_count_length;
+    world->m_unparsed_header = move(unparsed_header);
+    world->m_trailing_sections = move(trailing_sections);
+    world->m_trailing_section_offsets = move(trailing_section_offsets);
+
+    // Chests and signs don't depend on the tiles at all, so they can be read while the tiles are being decoded.
+    Optional<Error> chests_error;
+    auto chests_thread = Threading::Thread::construct(
+        [&]() -> intptr_t {
+            auto chests = read_chests(section_bytes(chests_section));
+            if (chests.is_error())
+                chests_error = chests.release_error();
+            else
+                world->m_chests = chests.release_value();
+            return 0;
+        },
+        "World chests"sv);
+
+    Optional<Error> signs_error;
+    auto signs_thread = Threading::Thread::construct(
+        [&]() -> intptr_t {
+            auto signs = read_signs(section_bytes(signs_section));
+            if (signs.is_error())
+                signs_error = signs.release_error();
+            else
+                world->m_signs = signs.release_value();
+            return 0;
+        },
+        "World signs"sv);
 
-            if (lower_wall_id.has_value())
-            {
-                if ((header3 & extended_wall_id_bit) == extended_wall_id_bit)
-                {
-                    stream >> temporary_8;
-                    tile.wall_id() = static_cast<Tile::WallId>((temporary_8 << 8) | *lower_wall_id);
-                }
-                else
-                {
-                    tile.wall_id() = static_cast<Tile::WallId>(*lower_wall_id);
-                }
-            }
+    chests_thread->start();
+    signs_thread->start();
 
-            if ((header2 & red_wire_bit) == red_wire_bit)
-                tile.set_red_wire(true);
+    ErrorOr<void> tiles_result;
+    if (lazy_tile_map)
+        lazy_tile_map->start_background_decoding(world->m_header.spawn_tile.x());
+    else
+        tiles_result = decode_tiles(*world->m_tile_map, section_bytes(tiles_section), world->m_importance);
 
-            if ((header2 & blue_wire_bit) == blue_wire_bit)
-                tile.set_blue_wire(true);
+    (void)chests_thread->join();
+    (void)signs_thread->join();
 
-            if ((header2 & green_wire_bit) == green_wire_bit)
-                tile.set_green_wire(true);
+    if (tiles_result.is_error())
+        return tiles_result.release_error();
 
-            if ((header3 & yellow_wire_bit) == yellow_wire_bit)
-                tile.set_yellow_wire(true);
+    if (chests_error.has_value())
+        return chests_error.release_value();
 
-            if ((header3 & m_actuator_bit) == m_actuator_bit)
-                tile.set_has_actuator(true);
+    if (signs_error.has_value())
+        return signs_error.release_value();
 
-            if ((header3 & m_actuated_bit) == m_actuated_bit)
-                tile.set_is_actuated(true);
+    return {world};
+}
 
-            u8 rle_type = (header1 & rle_bits) >> rle_shift;
-            if (rle_type == 1)
-            {
-                stream >> temporary_8;
-                rle = temporary_8;
-                tile_to_rle = &tile;
-            }
-            else if (rle_type == 2)
-            {
-                stream >> rle;
-                tile_to_rle = &tile;
-            }
-            else if (rle != 0)
+ErrorOr<void> World::save(OutputStream& stream) const
+{
+    // Every section is put together in memory first, as the section pointers at the very start of the file need to
+    // know how big they all are.
+    DuplexMemoryStream header_stream;
+    TRY(write_header(header_stream, m_header, m_kill_count_length));
+    header_stream.write_or_error(m_unparsed_header.span());
+    auto header_bytes = header_stream.copy_into_contiguous_buffer();
+
+    auto tile_buffers = encode_tiles(*m_tile_map, m_importance);
+    size_t tiles_size = 0;
+    for (auto& buffer : tile_buffers)
+        tiles_size += buffer.size();
+
+    DuplexMemoryStream chests_stream;
+    write_chests(chests_stream, m_chests);
+    auto chests_bytes = chests_stream.copy_into_contiguous_buffer();
+
+    DuplexMemoryStream signs_stream;
+    write_signs(signs_stream, m_signs);
+    auto signs_bytes = signs_stream.copy_into_contiguous_buffer();
+
+    // The section pointers, importance and everything before them don't change size based on what's in the pointers,
+    // so write them out once with placeholders just to find out where the header is going to start.
+    auto section_count = signs_section + 1 + m_trailing_section_offsets.size();
+    auto write_preamble = [&](OutputStream& preamble, const Vector<i32>& file_pointers) {
+        preamble << world_version_capable_of_loading;
+        preamble << m_metadata;
+
+        preamble << static_cast<u16>(file_pointers.size());
+        for (auto pointer : file_pointers)
+            preamble << pointer;
+
+        preamble << static_cast<u16>(m_importance.size());
+        for (size_t i = 0; i < m_importance.size(); i += 8)
+        {
+            u8 b = 0;
+            for (size_t bit = 0; bit < 8 && i + bit < m_importance.size(); bit++)
             {
-                VERIFY_NOT_REACHED();
+                if (m_importance[i + bit])
+                    b |= 1 << bit;
             }
+            preamble << b;
         }
-    }
+    };
 
-    // TODO: some other stuff like pointer validation? idk
+    Vector<i32> file_pointers;
+    file_pointers.resize(section_count);
 
-    u16 total_chests;
-    stream >> total_chests;
-    u16 items_slots_in_chests;
-    stream >> items_slots_in_chests;
+    DuplexMemoryStream placeholder_preamble;
+    write_preamble(placeholder_preamble, file_pointers);
 
-    for (auto i = 0; i < total_chests; i++)
+    file_pointers[0] = placeholder_preamble.size();
+    file_pointers[tiles_section] = file_pointers[0] + header_bytes.size();
+    file_pointers[chests_section] = file_pointers[tiles_section] + tiles_size;
+    file_pointers[signs_section] = file_pointers[chests_section] + chests_bytes.size();
+    for (size_t i = 0; i < m_trailing_section_offsets.size(); i++)
     {
-        Chest chest;
-        stream >> temporary_32;
-        chest.position().set_x(temporary_32);
+        file_pointers[signs_section + 1 + i] =
+            file_pointers[signs_section] + signs_bytes.size() + m_trailing_section_offsets[i];
+    }
 
-        stream >> temporary_32;
-        chest.position().set_y(temporary_32);
+    write_preamble(stream, file_pointers);
+    stream.write_or_error(header_bytes);
+    for (auto& buffer : tile_buffers)
+        stream.write_or_error(buffer.span());
+    stream.write_or_error(chests_bytes);
+    stream.write_or_error(signs_bytes);
+    stream.write_or_error(m_trailing_sections.span());
 
-        String name;
-        Net::Types::read_string(stream, name);
-        chest.set_name(move(name));
+    if (stream.handle_any_error())
+        return Error::from_string_literal("Unable to write world");
 
-        for (auto j = 0; j < items_slots_in_chests; j++)
-        {
-            stream >> temporary_16;
-            if (temporary_16 == 0)
-                continue;
+    return {};
+}
 
-            Item item;
-            item.set_stack(temporary_16);
+ErrorOr<void> World::save_to_file(const String& path) const
+{
+    DuplexMemoryStream stream;
+    TRY(save(stream));
+    auto bytes = stream.copy_into_contiguous_buffer();
 
-            int item_id;
-            stream >> item_id;
-            item.set_id(static_cast<Item::Id>(item_id));
+    auto temporary_path = String::formatted("{}.tmp", path);
+    int fd = open(temporary_path.characters(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return Error::from_errno(errno);
 
-            stream >> temporary_8;
-            item.set_prefix(static_cast<Item::Prefix>(temporary_8));
+    for (size_t written = 0; written < bytes.size();)
+    {
+        auto rc = write(fd, bytes.data() + written, bytes.size() - written);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
 
-            chest.contents().set(j, move(item));
+            auto error = Error::from_errno(errno);
+            close(fd);
+            unlink(temporary_path.characters());
+            return error;
         }
 
-        world->m_chests.set(i, move(chest));
+        written += rc;
     }
 
-    u16 total_signs;
-    stream >> total_signs;
+    // Make sure the data is actually on disk before the rename makes it the world, otherwise a crash could leave us
+    // with the new name pointing at nothing.
+    if (fsync(fd) < 0)
+    {
+        auto error = Error::from_errno(errno);
+        close(fd);
+        unlink(temporary_path.characters());
+        return error;
+    }
 
-    for (auto i = 0; i < total_signs; i++)
+    if (close(fd) < 0)
     {
-        Sign sign;
-        String text;
-        Net::Types::read_string(stream, text);
-        sign.set_text(move(text));
+        auto error = Error::from_errno(errno);
+        unlink(temporary_path.characters());
+        return error;
+    }
 
-        stream >> temporary_32;
-        sign.position().set_x(temporary_32);
-        stream >> temporary_32;
-        sign.position().set_y(temporary_32);
+    if (rename(temporary_path.characters(), path.characters()) < 0)
+        return Error::from_errno(errno);
 
-        world->m_signs.set(i, move(sign));
-    }
+    return {};
+}
 
-    return {world};
+NonnullRefPtr<World> World::snapshot() const
+{
+    auto world = adopt_ref(*new World(m_tile_map->snapshot()));
+    world->m_version = m_version;
+    world->m_metadata = m_metadata;
+    world->m_header = m_header;
+    world->m_chests = m_chests;
+    world->m_signs = m_signs;
+    world->m_importance = m_importance;
+    world->m_kill_count_length = m_kill_count_length;
+    world->m_unparsed_header = m_unparsed_header;
+    world->m_trailing_sections = m_trailing_sections;
+    world->m_trailing_section_offsets = m_trailing_section_offsets;
+    return world;
 }
 }
\ No newline at end of file
@@ -9,10 +9,12 @@
 #include <AK/Error.h>
 #include <AK/HashMap.h>
 #include <AK/RefCounted.h>
+#include <AK/Span.h>
 #include <AK/Stream.h>
 #include <AK/String.h>
 #include <AK/UUID.h>
 #include <AK/Vector.h>
+#include <LibCore/MappedFile.h>
 #include <LibTerraria/Chest.h>
 #include <LibTerraria/FileMetadata.h>
 #include <LibTerraria/GameMode.h>
@@ -169,9 +171,38 @@ public:
 
     static constexpr i32 world_version_capable_of_loading = 244;
 
+    // How the tiles of a loaded world are kept in memory.
+    enum class TileStorage
+    {
+        // One contiguous array of tiles.
+        Memory,
+        // Copy-on-write chunks, see ChunkedTileMap. Cheap to snapshot.
+        Chunked,
+        // Chunks of palette indices, see PalettedTileMap. Much smaller for mostly uniform worlds.
+        Paletted
+    };
+
     World(NonnullRefPtr<TileMap>);
 
-    static ErrorOr<NonnullRefPtr<World>> try_load_world(InputStream& stream);
+    // The world is decoded straight out of the given bytes, nothing is copied besides what ends up in the World.
+    // The bytes only need to live for the duration of this call.
+    static ErrorOr<NonnullRefPtr<World>> try_load_world(ReadonlyBytes bytes, TileStorage = TileStorage::Memory);
+
+    // Only the header, chests and signs are read up front, the tiles are decoded out of the mapping as they are
+    // needed (see LazyTileMap). The mapping is kept alive until every tile has been decoded.
+    static ErrorOr<NonnullRefPtr<World>> try_load_world_lazily(NonnullRefPtr<Core::MappedFile>);
+
+    // Writes the world out in the same format we load, with the section pointers worked out for what's written.
+    // The tiles are encoded on as many threads as we have, but this still blocks until the whole world is written.
+    ErrorOr<void> save(OutputStream&) const;
+
+    // Saves to a temporary file next to the given path first, and only replaces it once that has been fully written,
+    // so a crash in the middle of saving can't leave a half written world behind.
+    ErrorOr<void> save_to_file(const String& path) const;
+
+    // A copy of the world as it is right now, that can be saved from another thread while this one keeps changing.
+    // How cheap this is depends on the tile map, see TileMap::snapshot().
+    NonnullRefPtr<World> snapshot() const;
 
     Header& header() { return m_header; }
 
@@ -190,11 +221,21 @@ public:
     HashMap<u16, Sign>& signs() { return m_signs; }
 
 private:
+    static ErrorOr<NonnullRefPtr<World>> load_world(ReadonlyBytes bytes, TileStorage,
+                                                    RefPtr<Core::MappedFile> lazy_tile_source);
+
     i32 m_version{};
     FileMetadata m_metadata;
     Header m_header;
     HashMap<u16, Chest> m_chests;
     HashMap<u16, Sign> m_signs;
     NonnullRefPtr<TileMap> m_tile_map;
+
+    // Everything below is only needed to be able to save the world back out the way we found it.
+    Vector<bool> m_importance;
+    u16 m_kill_count_length{};
+    Vector<u8> m_unparsed_header;
+    Vector<u8> m_trailing_sections;
+    Vector<i32> m_trailing_section_offsets;
 };
 }
\ No newline at end of file
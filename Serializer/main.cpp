@@ -9,6 +9,7 @@
 #include <AK/JsonObject.h>
 #include <AK/LexicalPath.h>
 #include <AK/String.h>
+#include <AK/StringBuilder.h>
 #include <LibCore/ArgsParser.h>
 #include <LibCore/File.h>
 #include <LibMain/Main.h>
@@ -34,7 +35,8 @@ void get_array_info(const String& name, StringView& type, StringView& length)
 class Field
 {
 public:
-    Field(String name, String type, Optional<String> when) : m_name(move(name)), m_type(move(type)), m_when(move(when))
+    Field(String name, String type, Optional<String> when, Optional<String> flag = {}, Vector<u32> bits = {})
+        : m_name(move(name)), m_type(move(type)), m_when(move(when)), m_flag(move(flag)), m_bits(move(bits))
     {
     }
 
@@ -44,12 +46,388 @@ public:
 
     const Optional<String>& when() const { return m_when; }
 
+    // The field before this one whose bits say if this one is there at all.
+    const Optional<String>& flag() const { return m_flag; }
+
+    // One bit for plain fields, and one for every element of arrays.
+    const Vector<u32>& bits() const { return m_bits; }
+
+    bool is_flagged() const { return m_flag.has_value(); }
+
+    // Flagged fields are kept as an Optional, or as an array of them.
+    String member_type() const
+    {
+        if (!is_flagged())
+            return m_type;
+
+        if (m_type.starts_with("Array"))
+        {
+            StringView array_type;
+            StringView array_length;
+            get_array_info(m_type, array_type, array_length);
+            return String::formatted("Array<Optional<{}>, {}>", array_type, array_length);
+        }
+
+        return String::formatted("Optional<{}>", m_type);
+    }
+
+    // The type of a single value of this field, which is what's actually read or written.
+    String value_type() const
+    {
+        if (!is_flagged() || !m_type.starts_with("Array"))
+            return m_type;
+
+        StringView array_type;
+        StringView array_length;
+        get_array_info(m_type, array_type, array_length);
+        return array_type;
+    }
+
 private:
     String m_name;
     String m_type;
     Optional<String> m_when;
+    Optional<String> m_flag;
+    Vector<u32> m_bits;
 };
 
+// These are read and written with their own operators, which don't just copy sizeof(T) bytes around.
+bool is_variable_length(const String& type)
+{
+    return type == "String" || type == "NetworkText" || type == "PlayerDeathReason" ||
+           type == "Terraria::Character" || type == "Terraria::TileModification";
+}
+
+bool can_generate_view(const Vector<Field>& fields)
+{
+    for (auto& field : fields)
+    {
+        if (field.when().has_value() && *field.when() != "read")
+            continue;
+
+        // Strings are the only variable length field a view knows how to skip over.
+        if (field.is_flagged() || (is_variable_length(field.type()) && field.type() != "String"))
+            return false;
+    }
+
+    return true;
+}
+
+// A view checks that every field fits once, then reads them straight out of the bytes it was made from when asked.
+// Fields are at a constant offset until the first string, and where they are after that is remembered when it's made.
+void generate_view(const Vector<Field>& fields)
+{
+    outln("// Reads fields straight out of the bytes it was made from, which have to outlive it.");
+    outln("class View");
+    outln("{{");
+    outln("public:");
+    outln("static Optional<View> from_bytes(ReadonlyBytes bytes)");
+    outln("{{");
+    outln("View view(bytes);");
+
+    StringBuilder constant_offset;
+    constant_offset.append("0");
+    bool offset_is_constant = true;
+    Vector<String> stored_offsets;
+    Vector<String> stored_lengths;
+
+    for (auto& field : fields)
+    {
+        if (field.when().has_value() && *field.when() != "read")
+            continue;
+
+        if (field.type() == "String")
+        {
+            if (offset_is_constant)
+            {
+                outln("size_t offset = {};", constant_offset.string_view());
+                offset_is_constant = false;
+            }
+
+            outln("u32 {}_length;", field.name());
+            outln("auto {}_length_size = Terraria::Net::Types::read_7bit_encoded_int(bytes, offset, {}_length);",
+                  field.name(), field.name());
+            outln("if (!{}_length_size.has_value())", field.name());
+            outln("return {{}};");
+            outln("offset += *{}_length_size;", field.name());
+            outln("view.m_{}_offset = offset;", field.name());
+            outln("view.m_{}_length = {}_length;", field.name(), field.name());
+            outln("offset += {}_length;", field.name());
+            stored_offsets.append(field.name());
+            stored_lengths.append(field.name());
+        }
+        else if (offset_is_constant)
+        {
+            constant_offset.appendff(" + sizeof({})", field.type());
+        }
+        else
+        {
+            outln("view.m_{}_offset = offset;", field.name());
+            outln("offset += sizeof({});", field.type());
+            stored_offsets.append(field.name());
+        }
+    }
+
+    if (!offset_is_constant)
+    {
+        outln("if (offset > bytes.size())");
+        outln("return {{}};");
+    }
+    else if (constant_offset.length() > 1)
+    {
+        outln("if (bytes.size() < {})", constant_offset.string_view());
+        outln("return {{}};");
+    }
+    outln("return view;");
+    outln("}}");
+    outln();
+
+    outln("ReadonlyBytes bytes() const {{ return m_bytes; }}");
+    outln();
+
+    StringBuilder offset;
+    offset.append("0");
+    offset_is_constant = true;
+    for (auto& field : fields)
+    {
+        if (field.when().has_value() && *field.when() != "read")
+            continue;
+
+        if (field.type() == "String")
+        {
+            outln("StringView {}() const", field.name());
+            outln("{{");
+            outln("return {{reinterpret_cast<const char*>(m_bytes.offset_pointer(m_{}_offset)), m_{}_length}};",
+                  field.name(), field.name());
+            outln("}}");
+            offset_is_constant = false;
+        }
+        else if (offset_is_constant)
+        {
+            outln("{} {}() const {{ return read<{}>({}); }}", field.type(), field.name(), field.type(),
+                  offset.string_view());
+            offset.appendff(" + sizeof({})", field.type());
+        }
+        else
+        {
+            outln("{} {}() const {{ return read<{}>(m_{}_offset); }}", field.type(), field.name(), field.type(),
+                  field.name());
+        }
+    }
+
+    outln();
+    outln("private:");
+    outln("explicit View(ReadonlyBytes bytes) : m_bytes(bytes) {{}}");
+    outln();
+    outln("template<typename T>");
+    outln("T read(size_t offset) const");
+    outln("{{");
+    outln("T value;");
+    outln("__builtin_memcpy(&value, m_bytes.offset_pointer(offset), sizeof(T));");
+    outln("return value;");
+    outln("}}");
+    outln();
+    outln("ReadonlyBytes m_bytes;");
+    for (auto& name : stored_offsets)
+        outln("size_t m_{}_offset{{}};", name);
+    for (auto& name : stored_lengths)
+        outln("size_t m_{}_length{{}};", name);
+    outln("}};");
+    outln();
+}
+
+Vector<String> flags_fields(const Vector<Field>& fields)
+{
+    Vector<String> flags;
+    for (auto& field : fields)
+    {
+        if (field.is_flagged() && !flags.contains_slow(*field.flag()))
+            flags.append(*field.flag());
+    }
+
+    return flags;
+}
+
+String bit_mask(u32 bit)
+{
+    return String::formatted("(1 << {})", bit);
+}
+
+// Writing a flags field has to set the bits of every field that's there, and clear the ones of every field that isn't,
+// so there's no way of them disagreeing. A bit shared by a few fields is only set if all of them are there.
+void generate_presence_bits(const Vector<Field>& fields)
+{
+    for (auto& flag : flags_fields(fields))
+    {
+        String flag_type;
+        for (auto& field : fields)
+        {
+            if (field.name() == flag)
+                flag_type = field.type();
+        }
+
+        outln("{} {}_with_presence_bits() const", flag_type, flag);
+        outln("{{");
+        outln("auto value = m_{};", flag);
+        for (u32 bit = 0; bit < 32; bit++)
+        {
+            Vector<String> conditions;
+            for (auto& field : fields)
+            {
+                if (!field.is_flagged() || *field.flag() != flag)
+                    continue;
+
+                for (size_t i = 0; i < field.bits().size(); i++)
+                {
+                    if (field.bits()[i] != bit)
+                        continue;
+
+                    if (field.type().starts_with("Array"))
+                        conditions.append(String::formatted("m_{}[{}].has_value()", field.name(), i));
+                    else
+                        conditions.append(String::formatted("m_{}.has_value()", field.name()));
+                }
+            }
+
+            if (conditions.is_empty())
+                continue;
+
+            outln("if ({})", String::join(" && ", conditions));
+            outln("value |= {};", bit_mask(bit));
+            outln("else");
+            outln("value &= ~{};", bit_mask(bit));
+        }
+        outln("return value;");
+        outln("}}");
+        outln();
+    }
+}
+
+// Calls callback with the bit and expression of every value of a flagged field, which is every element for arrays.
+template<typename Callback>
+void for_each_flagged_value(const Field& field, StringView object, Callback callback)
+{
+    for (size_t i = 0; i < field.bits().size(); i++)
+    {
+        if (field.type().starts_with("Array"))
+            callback(field.bits()[i], String::formatted("{}m_{}[{}]", object, field.name(), i));
+        else
+            callback(field.bits()[i], String::formatted("{}m_{}", object, field.name()));
+    }
+}
+
+// Works out the flags once, before anything is written.
+void generate_presence_bits_locals(const Vector<Field>& fields)
+{
+    for (auto& flag : flags_fields(fields))
+        outln("auto {}_to_write = {}_with_presence_bits();", flag, flag);
+}
+
+bool can_generate_encode_into(const Vector<Field>& fields)
+{
+    for (auto& field : fields)
+    {
+        if (field.when().has_value() && *field.when() != "write")
+            continue;
+
+        if (is_variable_length(field.type()) && field.type() != "String")
+            return false;
+    }
+
+    return true;
+}
+
+// Everything but strings has a constant size, so packets without any get a constexpr size, and the others only have
+// to add up the length of their strings.
+void generate_encode_into(const Vector<Field>& fields, bool is_module)
+{
+    StringBuilder constant_size;
+    constant_size.append("sizeof(u16) + sizeof(Terraria::Net::Packet::Id)");
+    if (is_module)
+        constant_size.append(" + sizeof(Terraria::Net::Packet::ModuleId)");
+
+    Vector<String> strings;
+    bool has_flagged_fields = false;
+    for (auto& field : fields)
+    {
+        if (field.when().has_value() && *field.when() != "write")
+            continue;
+
+        if (field.type() == "String")
+            strings.append(field.name());
+        else if (field.is_flagged())
+            has_flagged_fields = true;
+        else
+            constant_size.appendff(" + sizeof({})", field.type());
+    }
+
+    if (strings.is_empty() && !has_flagged_fields)
+    {
+        outln("static constexpr size_t fixed_encoded_size = {};", constant_size.string_view());
+        outln();
+        outln("Optional<size_t> encoded_size() const override {{ return fixed_encoded_size; }}");
+    }
+    else
+    {
+        outln("Optional<size_t> encoded_size() const override");
+        outln("{{");
+        generate_presence_bits_locals(fields);
+        out("return {}", constant_size.string_view());
+        for (auto& name : strings)
+            out(" + Terraria::Net::Types::encoded_size_of_string(m_{})", name);
+        for (auto& field : fields)
+        {
+            if (!field.is_flagged() || (field.when().has_value() && *field.when() != "write"))
+                continue;
+
+            for_each_flagged_value(field, ""sv, [&](u32 bit, const auto&) {
+                out(" + (({}_to_write & {}) != 0 ? sizeof({}) : 0)", *field.flag(), bit_mask(bit), field.value_type());
+            });
+        }
+        outln(";");
+        outln("}}");
+    }
+    outln();
+
+    outln("void encode_into(Bytes bytes) const override");
+    outln("{{");
+    generate_presence_bits_locals(fields);
+    outln("size_t offset = 0;");
+    outln("Terraria::Net::Types::write(bytes, offset, static_cast<u16>(bytes.size()));");
+    outln("Terraria::Net::Types::write(bytes, offset, packet_id);");
+    if (is_module)
+        outln("Terraria::Net::Types::write(bytes, offset, module_id);");
+    auto flags = flags_fields(fields);
+    for (auto& field : fields)
+    {
+        if (field.when().has_value() && *field.when() != "write")
+            continue;
+
+        if (field.type() == "String")
+        {
+            outln("Terraria::Net::Types::write_string(bytes, offset, m_{});", field.name());
+        }
+        else if (field.is_flagged())
+        {
+            for_each_flagged_value(field, ""sv, [&](u32 bit, const auto& value) {
+                outln("if (({}_to_write & {}) != 0)", *field.flag(), bit_mask(bit));
+                outln("Terraria::Net::Types::write(bytes, offset, *{});", value);
+            });
+        }
+        else if (flags.contains_slow(field.name()))
+        {
+            outln("Terraria::Net::Types::write(bytes, offset, {}_to_write);", field.name());
+        }
+        else
+        {
+            outln("Terraria::Net::Types::write(bytes, offset, m_{});", field.name());
+        }
+    }
+    outln("VERIFY(offset == bytes.size());");
+    outln("}}");
+    outln();
+}
+
 ErrorOr<int> serenity_main(Main::Arguments arguments)
 {
     Core::ArgsParser args_parser;
@@ -134,9 +512,61 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
             auto when_obj = value.as_object().get("when");
             Optional<String> when =
                 when_obj.type() == AK::JsonValue::Type::String ? when_obj.as_string() : Optional<String>{};
-            fields.append(Field(move(name), move(type), move(when)));
+
+            // A field can be made to depend on a bit of an earlier field, with "flag" naming that field and "bit"
+            // being which of its bits. Arrays have "bits" instead, one for every element.
+            auto flag_obj = value.as_object().get("flag");
+            Optional<String> flag =
+                flag_obj.type() == AK::JsonValue::Type::String ? flag_obj.as_string() : Optional<String>{};
+            Vector<u32> bits;
+            auto bit_obj = value.as_object().get("bit");
+            if (bit_obj.is_number())
+                bits.append(bit_obj.to_u32());
+            auto bits_obj = value.as_object().get("bits");
+            if (bits_obj.is_array())
+                bits_obj.as_array().for_each([&](auto& bit) { bits.append(bit.to_u32()); });
+
+            fields.append(Field(move(name), move(type), move(when), move(flag), move(bits)));
         });
 
+        for (size_t i = 0; i < fields.size(); i++)
+        {
+            auto& field = fields[i];
+            if (!field.is_flagged())
+                continue;
+
+            bool flag_is_before = false;
+            for (size_t j = 0; j < i; j++)
+            {
+                if (fields[j].name() == *field.flag())
+                    flag_is_before = true;
+            }
+
+            if (!flag_is_before)
+            {
+                warnln("Field {} depends on {}, which has to be a field before it.", field.name(), *field.flag());
+                return 5;
+            }
+
+            if (is_variable_length(field.type()))
+            {
+                warnln("Field {} can't depend on a flag, only fields that are always the same size can.", field.name());
+                return 5;
+            }
+
+            StringView array_type;
+            StringView array_length;
+            if (field.type().starts_with("Array"))
+                get_array_info(field.type(), array_type, array_length);
+            auto expected_bits = field.type().starts_with("Array") ? array_length.to_uint().value_or(0) : 1;
+            if (field.bits().size() != expected_bits)
+            {
+                warnln("Field {} needs {} bits of {}, but has {}.", field.name(), expected_bits, *field.flag(),
+                       field.bits().size());
+                return 5;
+            }
+        }
+
         AK::LexicalPath lexical_path(input_file_path);
         Optional<String> module;
         auto module_obj = json_object.get("module");
@@ -173,6 +603,16 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
         outln("{{");
 
         outln("public:");
+        if (module.has_value())
+        {
+            outln("static constexpr auto packet_id = Terraria::Net::Packet::Id::NetModules;");
+            outln("static constexpr auto module_id = Terraria::Net::Packet::ModuleId::{};", class_name);
+        }
+        else
+        {
+            outln("static constexpr auto packet_id = Terraria::Net::Packet::Id::{};", class_name);
+        }
+        outln();
         outln("{}() = default;", class_name);
         outln();
 
@@ -191,7 +631,18 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
             if (field.when().has_value() && *field.when() != "read")
                 continue;
 
-            if (field.type() == "String")
+            if (field.is_flagged())
+            {
+                for_each_flagged_value(field, "packet."sv, [&](u32 bit, const auto& value) {
+                    outln("if ((packet.m_{} & {}) != 0)", *field.flag(), bit_mask(bit));
+                    outln("{{");
+                    outln("{} value{{}};", field.value_type());
+                    outln("stream >> value;");
+                    outln("{} = value;", value);
+                    outln("}}");
+                });
+            }
+            else if (field.type() == "String")
             {
                 outln("Terraria::Net::Types::read_string(stream, packet.m_{});", field.name());
             }
@@ -214,28 +665,34 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
         outln("}}");
         outln();
 
+        if (can_generate_view(fields))
+            generate_view(fields);
+
         outln("ByteBuffer to_bytes() const override");
         outln("{{");
-        if (module.has_value())
-        {
-            outln("static constexpr auto packet_id = Terraria::Net::Packet::Id::NetModules;");
-            outln("static constexpr auto module_id = Terraria::Net::Packet::ModuleId::{};", class_name);
-        }
-        else
-        {
-            outln("static constexpr auto packet_id = Terraria::Net::Packet::Id::{};", class_name);
-        }
-
+        generate_presence_bits_locals(fields);
         outln("DuplexMemoryStream stream;");
         outln("stream << packet_id;");
         if (module.has_value())
             outln("stream << module_id;");
+        auto flags = flags_fields(fields);
         for (auto& field : fields)
         {
             if (field.when().has_value() && *field.when() != "write")
                 continue;
 
-            if (field.type() == "String")
+            if (field.is_flagged())
+            {
+                for_each_flagged_value(field, ""sv, [&](u32 bit, const auto& value) {
+                    outln("if (({}_to_write & {}) != 0)", *field.flag(), bit_mask(bit));
+                    outln("stream << *{};", value);
+                });
+            }
+            else if (flags.contains_slow(field.name()))
+            {
+                outln("stream << {}_to_write;", field.name());
+            }
+            else if (field.type() == "String")
             {
                 outln("Terraria::Net::Types::write_string(stream, m_{});", field.name());
             }
@@ -258,9 +715,18 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
 
         outln("}}");
         outln();
+
+        if (can_generate_encode_into(fields))
+            generate_encode_into(fields, module.has_value());
+
         for (auto& field : fields)
         {
-            if (field.type() == "String")
+            if (field.is_flagged())
+            {
+                outln("const {}& {}() const {{ return m_{}; }}", field.member_type(), field.name(), field.name());
+                outln("{}& {}() {{ return m_{}; }}", field.member_type(), field.name(), field.name());
+            }
+            else if (field.type() == "String")
             {
                 outln("const String& {}() const {{ return m_{}; }}", field.name(), field.name());
                 outln("void set_{}(String value) {{ m_{} = move(value); }}", field.name(), field.name());
@@ -290,6 +756,11 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
                 outln("const Terraria::TilePoint& {}() const {{ return m_{}; }}", field.name(), field.name());
                 outln("Terraria::TilePoint& {}() {{ return m_{}; }}", field.name(), field.name());
             }
+            else if (field.type().starts_with("Terraria::EntityPoint"))
+            {
+                outln("const Terraria::EntityPoint& {}() const {{ return m_{}; }}", field.name(), field.name());
+                outln("Terraria::EntityPoint& {}() {{ return m_{}; }}", field.name(), field.name());
+            }
             else if (field.type().starts_with("Terraria::TileModification"))
             {
                 outln("const Terraria::TileModification& {}() const {{ return m_{}; }}", field.name(), field.name());
@@ -305,10 +776,13 @@ ErrorOr<int> serenity_main(Main::Arguments arguments)
 
         outln();
         outln("private:");
+        generate_presence_bits(fields);
         for (auto& field : fields)
         {
+            if (field.is_flagged())
+                outln("{} m_{};", field.member_type(), field.name());
             // This should be correct for most cases.
-            if (field.type() != "String" && field.type() != "NetworkText" && !field.type().starts_with("Array") &&
+            else if (field.type() != "String" && field.type() != "NetworkText" && !field.type().starts_with("Array") &&
                 !field.type().starts_with("Terraria::Character"))
                 outln("{} m_{}{{}};", field.type(), field.name());
             else
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <AK/Atomic.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <Server/BufferPool.h>
+#include <stdlib.h>
+
+static Atomic<u64> s_hits;
+static Atomic<u64> s_misses;
+static Atomic<size_t> s_bytes_in_use;
+static Atomic<size_t> s_bytes_in_use_high_water;
+
+namespace
+{
+struct ThreadCache
+{
+    ~ThreadCache()
+    {
+        for (auto& buffers : free_buffers)
+        {
+            for (auto* buffer : buffers)
+                free(buffer);
+        }
+    }
+
+    Array<Vector<u8*>, BufferPool::size_classes.size()> free_buffers;
+};
+}
+
+static thread_local ThreadCache s_thread_cache;
+
+static Optional<size_t> size_class_for(size_t size)
+{
+    for (size_t i = 0; i < BufferPool::size_classes.size(); i++)
+    {
+        if (size <= BufferPool::size_classes[i])
+            return i;
+    }
+
+    return {};
+}
+
+BufferPool::Stats BufferPool::stats()
+{
+    return {s_hits.load(AK::memory_order_relaxed), s_misses.load(AK::memory_order_relaxed),
+            s_bytes_in_use.load(AK::memory_order_relaxed), s_bytes_in_use_high_water.load(AK::memory_order_relaxed)};
+}
+
+Bytes BufferPool::allocate(size_t size)
+{
+    auto size_class = size_class_for(size);
+    auto capacity = size_class.has_value() ? size_classes[*size_class] : size;
+
+    auto in_use = s_bytes_in_use.fetch_add(capacity, AK::memory_order_relaxed) + capacity;
+    auto high_water = s_bytes_in_use_high_water.load(AK::memory_order_relaxed);
+    while (in_use > high_water &&
+           !s_bytes_in_use_high_water.compare_exchange_strong(high_water, in_use, AK::memory_order_relaxed))
+    {
+    }
+
+    if (size_class.has_value())
+    {
+        auto& buffers = s_thread_cache.free_buffers[*size_class];
+        if (!buffers.is_empty())
+        {
+            s_hits.fetch_add(1, AK::memory_order_relaxed);
+            return {buffers.take_last(), capacity};
+        }
+    }
+
+    s_misses.fetch_add(1, AK::memory_order_relaxed);
+    auto* buffer = static_cast<u8*>(malloc(capacity));
+    VERIFY(buffer);
+    return {buffer, capacity};
+}
+
+void BufferPool::deallocate(Bytes buffer)
+{
+    s_bytes_in_use.fetch_sub(buffer.size(), AK::memory_order_relaxed);
+
+    // Buffers are always exactly the size of their class, so anything else was too big to have one.
+    auto size_class = size_class_for(buffer.size());
+    if (size_class.has_value() && size_classes[*size_class] == buffer.size())
+    {
+        auto& buffers = s_thread_cache.free_buffers[*size_class];
+        if (buffers.size() < max_free_buffers_per_class)
+        {
+            buffers.append(buffer.data());
+            return;
+        }
+    }
+
+    free(buffer.data());
+}
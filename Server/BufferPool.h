@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/Noncopyable.h>
+#include <AK/Span.h>
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+
+// Hands out buffers in a handful of sizes, and keeps the ones given back around for the next time somebody wants one
+// of the same size, so sending and receiving packets doesn't go through malloc every time. Every thread keeps its
+// own free buffers, so nothing here ever takes a lock.
+class BufferPool
+{
+public:
+    static constexpr Array<size_t, 6> size_classes{64, 256, 1 * KiB, 4 * KiB, 16 * KiB, 64 * KiB};
+
+    // How many free buffers of each size a thread holds onto, anything past that goes back to malloc.
+    static constexpr size_t max_free_buffers_per_class = 256;
+
+    struct Stats
+    {
+        u64 hits{};
+        u64 misses{};
+        size_t bytes_in_use{};
+        size_t bytes_in_use_high_water{};
+    };
+
+    // These are counted across every thread.
+    static Stats stats();
+
+    // The buffer is at least this big, and might be bigger. Anything bigger than the largest size class is allocated
+    // and freed as-is.
+    static Bytes allocate(size_t size);
+
+    // Has to be given exactly what allocate() gave back, but can be from any thread.
+    static void deallocate(Bytes);
+};
+
+// A buffer from the pool that goes back to it when it's destroyed.
+class PooledBuffer
+{
+    AK_MAKE_NONCOPYABLE(PooledBuffer);
+
+public:
+    PooledBuffer() = default;
+
+    explicit PooledBuffer(size_t size) : m_buffer(BufferPool::allocate(size)), m_size(size) {}
+
+    PooledBuffer(PooledBuffer&& other) : m_buffer(exchange(other.m_buffer, {})), m_size(exchange(other.m_size, 0)) {}
+
+    PooledBuffer& operator=(PooledBuffer&& other)
+    {
+        if (this != &other)
+        {
+            release();
+            m_buffer = exchange(other.m_buffer, {});
+            m_size = exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    ~PooledBuffer() { release(); }
+
+    u8* data() { return m_buffer.data(); }
+
+    const u8* data() const { return m_buffer.data(); }
+
+    size_t size() const { return m_size; }
+
+    Bytes bytes() { return m_buffer.trim(m_size); }
+
+    ReadonlyBytes bytes() const { return m_buffer.trim(m_size); }
+
+private:
+    void release()
+    {
+        if (!m_buffer.is_null())
+            BufferPool::deallocate(m_buffer);
+        m_buffer = {};
+        m_size = 0;
+    }
+
+    Bytes m_buffer;
+    size_t m_size{};
+};
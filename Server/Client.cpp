@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include <AK/Array.h>
 #include <LibTerraria/Net/NetworkText.h>
 #include <LibTerraria/Net/Packets/ClientUUID.h>
 #include <LibTerraria/Net/Packets/ConnectFinished.h>
@@ -31,15 +32,34 @@
 #include <LibTerraria/Net/Packets/WorldData.h>
 #include <Server/Client.h>
 #include <Server/Server.h>
+#include <errno.h>
 #include <math.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #define USE_BOGUS_KEEP_ALIVE_PACKET 0
 
 Client::Client(NonnullRefPtr<Core::TCPSocket> socket, Server& server, u8 id)
-    : m_socket(move(socket)), m_id(id), m_stream(m_socket), m_server(server)
+    : m_socket(move(socket)), m_id(id), m_server(server)
 {
+    m_inbound = PooledBuffer(inbound_capacity);
+
     m_socket->on_ready_to_read = [this]() { on_ready_to_read(); };
 
+    // Only listened to while there's something queued that the socket wasn't ready for.
+    m_write_notifier = Core::Notifier::construct(m_socket->fd(), Core::Notifier::Event::Write);
+    m_write_notifier->on_ready_to_write = [this]() { flush_outbound(); };
+    m_write_notifier->set_enabled(false);
+
+    // We already put everything sent in an event loop iteration together into as few writes as we can, Nagle would
+    // only hold the last of them back waiting for an ACK.
+    int nodelay = 1;
+    if (setsockopt(m_socket->fd(), IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) < 0)
+        perror("setsockopt(TCP_NODELAY)");
+
     if constexpr (USE_BOGUS_KEEP_ALIVE_PACKET)
     {
         m_keep_alive_timer = Core::Timer::create_repeating(5000, [this] { send_keep_alive(); });
@@ -47,17 +67,162 @@ Client::Client(NonnullRefPtr<Core::TCPSocket> socket, Server& server, u8 id)
     }
 }
 
-void Client::send(const Terraria::Net::Packet& packet)
+void Client::send(const Terraria::Net::Packet& packet, Priority priority)
 {
-    auto bytes = packet.to_bytes();
-    m_stream << static_cast<u16>(bytes.size() + 2);
-    m_stream << bytes;
-    if (m_stream.handle_any_error())
+    if (m_outbound_failed || (priority == Priority::Low && m_congested))
     {
-        m_in_process_of_disconnecting = true;
-        warnln("Stream errored trying to send data");
-        m_server.client_did_disconnect({}, *this, DisconnectReason::StreamErrored);
+        m_outbound_stats.dropped_packets++;
+        return;
     }
+
+    auto encode_start = Time::now_monotonic();
+    auto encoded = EncodedPacket::create(packet);
+    auto encode_time = Time::now_monotonic() - encode_start;
+    m_packet_stats.record_encode(encoded->id(), encode_time);
+    m_server.packet_stats().record_encode(encoded->id(), encode_time);
+
+    send_encoded(move(encoded), priority);
+}
+
+void Client::send_encoded(NonnullRefPtr<EncodedPacket> packet, Priority priority)
+{
+    if (m_outbound_failed || (priority == Priority::Low && m_congested))
+    {
+        m_outbound_stats.dropped_packets++;
+        return;
+    }
+
+    m_packet_stats.record_outbound(packet->id(), packet->size());
+    m_server.packet_stats().record_outbound(packet->id(), packet->size());
+
+    m_queued_bytes += packet->size();
+    m_outbound_stats.max_queued_bytes = max(m_outbound_stats.max_queued_bytes, m_queued_bytes);
+    m_outbound.append(move(packet));
+    update_congestion();
+
+    // If the socket was full, we're already waiting to hear it can take more. Otherwise, everything sent to this
+    // client until the event loop comes back around goes out together.
+    if (m_write_notifier->is_enabled() || m_flush_scheduled || m_outbound_failed)
+        return;
+
+    m_flush_scheduled = true;
+    m_server.client_did_queue_outbound({}, *this);
+}
+
+void Client::flush_outbound()
+{
+    m_flush_scheduled = false;
+
+    while (m_outbound_head < m_outbound.size())
+    {
+        Array<iovec, max_packets_per_send> iovecs;
+        auto iovec_count = min(m_outbound.size() - m_outbound_head, iovecs.size());
+        for (size_t i = 0; i < iovec_count; i++)
+        {
+            auto bytes = m_outbound[m_outbound_head + i]->bytes();
+            if (i == 0)
+                bytes = bytes.slice(m_outbound_offset);
+
+            iovecs[i] = {const_cast<u8*>(bytes.data()), bytes.size()};
+        }
+
+        msghdr message{};
+        message.msg_iov = iovecs.data();
+        message.msg_iovlen = iovec_count;
+
+        auto nwritten = ::sendmsg(m_socket->fd(), &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+        m_outbound_stats.send_calls++;
+        if (nwritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            warnln("Failed to send to client {}: {}", m_id, strerror(errno));
+            outbound_did_fail(DisconnectReason::StreamErrored);
+            return;
+        }
+
+        m_outbound_stats.sent_bytes += nwritten;
+        m_queued_bytes -= nwritten;
+
+        size_t remaining = nwritten;
+        size_t fully_written = 0;
+        while (fully_written < iovec_count && remaining >= iovecs[fully_written].iov_len)
+            remaining -= iovecs[fully_written++].iov_len;
+
+        m_outbound_head += fully_written;
+        m_outbound_stats.sent_packets += fully_written;
+        if (fully_written > 0)
+            m_outbound_offset = 0;
+        m_outbound_offset += remaining;
+
+        // The socket took less than we gave it, so it's full for now.
+        if (fully_written < iovec_count)
+            break;
+    }
+
+    if (m_outbound_head == m_outbound.size())
+    {
+        m_outbound.clear_with_capacity();
+        m_outbound_head = 0;
+    }
+    else if (m_outbound_head >= m_outbound.size() / 2)
+    {
+        m_outbound.remove(0, m_outbound_head);
+        m_outbound_head = 0;
+    }
+
+    m_write_notifier->set_enabled(!m_outbound.is_empty());
+    update_congestion();
+}
+
+void Client::update_congestion()
+{
+    if (m_queued_bytes > outbound_limit)
+    {
+        warnln("Client {} has {} bytes queued up, which is more than we'll hold for anybody", m_id, m_queued_bytes);
+        outbound_did_fail(DisconnectReason::TooSlow);
+        return;
+    }
+
+    if (!m_congested && m_queued_bytes > outbound_high_watermark)
+    {
+        m_congested = true;
+        m_congested_timer.start();
+        dbgln("Client {} is congested with {} bytes queued up, dropping low priority packets", m_id, m_queued_bytes);
+    }
+    else if (m_congested && m_queued_bytes < outbound_low_watermark)
+    {
+        m_congested = false;
+        dbgln("Client {} caught up after {}ms", m_id, m_congested_timer.elapsed());
+    }
+
+    if (m_congested && m_congested_timer.elapsed() > outbound_congestion_timeout_ms)
+    {
+        warnln("Client {} has been congested for over {}ms", m_id, outbound_congestion_timeout_ms);
+        outbound_did_fail(DisconnectReason::TooSlow);
+    }
+}
+
+void Client::outbound_did_fail(DisconnectReason reason)
+{
+    // Whatever is still queued is never going to make it, and nothing else should be queued after it.
+    m_outbound_failed = true;
+    m_outbound.clear();
+    m_flush_scheduled = false;
+    m_queued_bytes = 0;
+    m_outbound_head = 0;
+    m_outbound_offset = 0;
+    m_write_notifier->set_enabled(false);
+
+    if (m_in_process_of_disconnecting)
+        return;
+
+    m_in_process_of_disconnecting = true;
+    m_server.client_did_disconnect({}, *this, reason);
 }
 
 void Client::disconnect(const Terraria::Net::NetworkText& reason)
@@ -69,18 +234,8 @@ void Client::disconnect(const Terraria::Net::NetworkText& reason)
     m_server.client_did_disconnect({}, *this, DisconnectReason::DisconnectedByServer);
 }
 
-void Client::full_sync(Client& to)
+void Client::sync_position(Client& to)
 {
-    Terraria::Net::Packets::PlayerActive player_active;
-    player_active.set_player_id(m_id);
-    player_active.set_active(1);
-    to.send(player_active);
-
-    Terraria::Net::Packets::PlayerInfo player_info;
-    player_info.set_player_id(m_id);
-    player_info.set_character(m_player.character());
-    to.send(player_info);
-
     Terraria::Net::Packets::SyncPlayer sync_player;
     sync_player.set_player_id(m_id);
     sync_player.set_control_bits(m_player.control_bits());
@@ -92,6 +247,21 @@ void Client::full_sync(Client& to)
     sync_player.velocity() = m_player.velocity();
     // TODO: Potion of return information
     to.send(sync_player);
+}
+
+void Client::full_sync(Client& to)
+{
+    Terraria::Net::Packets::PlayerActive player_active;
+    player_active.set_player_id(m_id);
+    player_active.set_active(1);
+    to.send(player_active);
+
+    Terraria::Net::Packets::PlayerInfo player_info;
+    player_info.set_player_id(m_id);
+    player_info.set_character(m_player.character());
+    to.send(player_info);
+
+    sync_position(to);
 
     if (m_player.hp() <= 0)
     {
@@ -140,228 +310,124 @@ void Client::full_sync(Client& to)
 
 void Client::on_ready_to_read()
 {
-    if (m_socket->eof())
-    {
-        m_in_process_of_disconnecting = true;
-        m_server.client_did_disconnect({}, *this, DisconnectReason::EofReached);
+    if (m_in_process_of_disconnecting)
         return;
-    }
 
-    u16 packet_size;
-    m_stream >> packet_size;
-
-    if (m_stream.handle_any_error())
+    // Take everything the socket has for us, as much as fits.
+    for (;;)
     {
-        m_in_process_of_disconnecting = true;
-        warnln("Stream errored trying to read packet size");
-        m_server.client_did_disconnect({}, *this, DisconnectReason::StreamErrored);
-        return;
-    }
+        // Whatever was already handled is moved out of the way, so a partial frame always has room to finish.
+        if (m_inbound_start > 0 && m_inbound_end == inbound_capacity)
+        {
+            memmove(m_inbound.data(), m_inbound.data() + m_inbound_start, m_inbound_end - m_inbound_start);
+            m_inbound_end -= m_inbound_start;
+            m_inbound_start = 0;
+        }
 
-    Terraria::Net::Packet::Id packet_id;
-    m_stream >> packet_id;
-    if (m_stream.handle_any_error())
-    {
-        m_in_process_of_disconnecting = true;
-        warnln("Stream errored trying to read packet id");
-        m_server.client_did_disconnect({}, *this, DisconnectReason::StreamErrored);
-        return;
-    }
+        auto space = inbound_capacity - m_inbound_end;
+        if (space == 0)
+            break;
 
-    // The packet size (2 bytes) and id (1 byte) are part of this.
-    auto bytes = m_socket->read(packet_size - 3);
-    InputMemoryStream packet_bytes_stream(bytes);
+        auto nread = ::recv(m_socket->fd(), m_inbound.data() + m_inbound_end, space, MSG_DONTWAIT);
+        if (nread == 0)
+        {
+            m_in_process_of_disconnecting = true;
+            m_server.client_did_disconnect({}, *this, DisconnectReason::EofReached);
+            return;
+        }
 
-    // TODO: Some of these packets contain the player id, but we ignore that and assume it's the player id we assigned
-    // to this socket.
+        if (nread < 0)
+        {
+            if (errno == EINTR)
+                continue;
 
-    // Connection request, let's send a user slot
-    if (packet_id == Terraria::Net::Packet::Id::ConnectRequest)
-    {
-        auto request = Terraria::Net::Packets::ConnectRequest::from_bytes(packet_bytes_stream);
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
 
-        m_server.client_did_connect_request({}, *this, request->version());
+            warnln("Failed to read from client {}: {}", m_id, strerror(errno));
+            m_in_process_of_disconnecting = true;
+            m_server.client_did_disconnect({}, *this, DisconnectReason::StreamErrored);
+            return;
+        }
 
-        Terraria::Net::Packets::SetUserSlot set_user_slot;
-        set_user_slot.set_player_id(m_id);
-        send(set_user_slot);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerInfo)
-    {
-        auto player_info = Terraria::Net::Packets::PlayerInfo::from_bytes(packet_bytes_stream);
-        m_player.character() = player_info->character();
-        outln("Got character, created player for {}", m_player.character().name());
-        m_server.client_did_send_player_info({}, *this, *player_info);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncInventorySlot)
-    {
-        auto inv_slot = Terraria::Net::Packets::SyncInventorySlot::from_bytes(packet_bytes_stream);
-        if (inv_slot->item().id() == Terraria::Item::Id::None)
-            m_player.inventory().set_item(inv_slot->slot(), {});
-        else
-            m_player.inventory().set_item(inv_slot->slot(), inv_slot->item());
-        m_server.client_did_sync_inventory_slot({}, *this, *inv_slot);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::RequestWorldData)
-    {
-        m_server.client_did_request_world_data({}, *this);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::ClientUUID)
-    {
-        auto client_uuid = Terraria::Net::Packets::ClientUUID::from_bytes(packet_bytes_stream);
-        if (client_uuid->uuid().length() != 36)
-            warnln("Client sent UUID that isn't 36 characters.");
-        else
-            m_uuid = UUID(client_uuid->uuid().view());
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerHP)
-    {
-        auto player_hp = Terraria::Net::Packets::PlayerHP::from_bytes(packet_bytes_stream);
-        m_player.set_hp(player_hp->hp());
-        m_player.set_max_hp(player_hp->max_hp());
-        m_server.client_did_sync_hp({}, *this, *player_hp);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerBuffs)
-    {
-        auto player_buffs = Terraria::Net::Packets::PlayerBuffs::from_bytes(packet_bytes_stream);
-        player_buffs->buffs().span().copy_to(m_player.buffs().span());
-        m_server.client_did_sync_buffs({}, *this, *player_buffs);
+        m_inbound_end += nread;
+        if (static_cast<size_t>(nread) < space)
+            break;
     }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerMana)
-    {
-        auto player_mana = Terraria::Net::Packets::PlayerMana::from_bytes(packet_bytes_stream);
-        m_player.set_mana(player_mana->mana());
-        m_player.set_max_mana(player_mana->max_mana());
-        m_server.client_did_sync_mana({}, *this, *player_mana);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SpawnData)
-    {
-        auto spawn_data = Terraria::Net::Packets::SpawnData::from_bytes(packet_bytes_stream);
-        m_server.client_did_request_spawn_sections({}, *this, *spawn_data);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SpawnPlayer)
+
+    handle_inbound_frames();
+}
+
+void Client::handle_inbound_frames()
+{
+    m_inbound_continuation_scheduled = false;
+
+    size_t frames_handled = 0;
+    while (!m_in_process_of_disconnecting)
     {
-        auto spawn_player = Terraria::Net::Packets::SpawnPlayer::from_bytes(packet_bytes_stream);
-        outln("Wants to spawn player, probably themselves. Fuck that, let's just tell them to finish.");
-        if (!m_has_finished_connecting)
+        auto available = m_inbound_end - m_inbound_start;
+        if (available < 2)
+            break;
+
+        auto* frame = m_inbound.data() + m_inbound_start;
+        u16 frame_size = frame[0] | (frame[1] << 8);
+
+        // The frame size counts itself (2 bytes) and the packet id (1 byte).
+        if (frame_size < 3)
         {
-            m_server.client_did_finish_connecting({}, *this);
-            Terraria::Net::Packets::ConnectFinished connect_finished;
-            send(connect_finished);
-            m_has_finished_connecting = true;
+            warnln("Client {} sent a frame of {} bytes, which is too small to hold a packet", m_id, frame_size);
+            m_in_process_of_disconnecting = true;
+            m_server.client_did_disconnect({}, *this, DisconnectReason::StreamErrored);
+            return;
         }
-        m_server.client_did_spawn_player({}, *this, *spawn_player);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncPlayer)
-    {
-        auto sync_player = Terraria::Net::Packets::SyncPlayer::from_bytes(packet_bytes_stream);
-        m_player.set_control_bits(sync_player->control_bits());
-        m_player.set_bits_2(sync_player->bits_2());
-        m_player.set_bits_3(sync_player->bits_3());
-        m_player.set_bits_4(sync_player->bits_4());
-        m_player.inventory().set_selected_slot(
-            static_cast<Terraria::PlayerInventory::Slot>(sync_player->selected_item()));
-        m_player.position() = sync_player->position();
-        if (sync_player->velocity().has_value())
-            m_player.velocity() = *sync_player->velocity();
-        // TODO: Do something with potion of return use and home position
-        m_server.client_did_sync_player({}, *this, *sync_player);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncProjectile)
-    {
-        auto proj = Terraria::Net::Packets::SyncProjectile::from_bytes(packet_bytes_stream);
-        m_server.client_did_sync_projectile({}, *this, *proj);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::NetModules)
-    {
-        Terraria::Net::Packet::ModuleId module;
-        packet_bytes_stream >> module;
-        if (module == Terraria::Net::Packet::ModuleId::Text)
+
+        if (available < frame_size)
+            break;
+
+        // One client sending a flood of packets shouldn't hold up everybody else, so we only handle so many at a time,
+        // and come back to the rest once the event loop has gotten around to everything else.
+        if (frames_handled == max_frames_per_read)
         {
-            auto text = Terraria::Net::Packets::Modules::Text::from_bytes(packet_bytes_stream);
-            if (text->command_name() == "Say")
-                m_server.client_did_send_message({}, *this, text->message());
+            if (!m_inbound_continuation_scheduled)
+            {
+                m_inbound_continuation_scheduled = true;
+                m_server.deferred_invoke([client = make_weak_ptr()]() {
+                    if (client)
+                        client->handle_inbound_frames();
+                });
+            }
+            break;
         }
+
+        m_inbound_start += frame_size;
+        frames_handled++;
+        handle_packet(static_cast<Terraria::Net::Packet::Id>(frame[2]), {frame + 3, frame_size - 3u});
     }
-    else if (packet_id == Terraria::Net::Packet::Id::KillProjectile)
-    {
-        auto kill_proj = Terraria::Net::Packets::KillProjectile::from_bytes(packet_bytes_stream);
-        m_server.client_did_kill_projectile({}, *this, *kill_proj);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::TogglePvp)
-    {
-        auto toggle_pvp = Terraria::Net::Packets::TogglePvp::from_bytes(packet_bytes_stream);
-        m_server.client_did_toggle_pvp({}, *this, *toggle_pvp);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerHurt)
-    {
-        auto player_hurt = Terraria::Net::Packets::PlayerHurt::from_bytes(packet_bytes_stream);
-        m_server.client_did_hurt_player({}, *this, *player_hurt);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerDeath)
-    {
-        auto player_death = Terraria::Net::Packets::PlayerDeath::from_bytes(packet_bytes_stream);
-        m_server.client_did_player_death({}, *this, *player_death);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::DamageNPC)
-    {
-        auto damage_npc = Terraria::Net::Packets::DamageNPC::from_bytes(packet_bytes_stream);
-        m_server.client_did_damage_npc({}, *this, *damage_npc);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerItemAnimation)
-    {
-        auto item_anim = Terraria::Net::Packets::PlayerItemAnimation::from_bytes(packet_bytes_stream);
-        m_server.client_did_item_animation({}, *this, *item_anim);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::ModifyTile)
-    {
-        auto modify_tile = Terraria::Net::Packets::ModifyTile::from_bytes(packet_bytes_stream);
-        m_server.client_did_modify_tile({}, *this, *modify_tile);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncTilePicking)
-    {
-        auto sync_tile_picking = Terraria::Net::Packets::SyncTilePicking::from_bytes(packet_bytes_stream);
-        m_server.client_did_sync_tile_picking({}, *this, *sync_tile_picking);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::AddPlayerBuff)
-    {
-        auto add_player_buff = Terraria::Net::Packets::AddPlayerBuff::from_bytes(packet_bytes_stream);
-        m_server.client_did_add_player_buff({}, *this, *add_player_buff);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncTalkNPC)
-    {
-        auto sync_talk_npc = Terraria::Net::Packets::SyncTalkNPC::from_bytes(packet_bytes_stream);
-        m_server.client_did_sync_talk_npc({}, *this, *sync_talk_npc);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlayerTeam)
-    {
-        auto player_team = Terraria::Net::Packets::PlayerTeam::from_bytes(packet_bytes_stream);
-        m_server.client_did_sync_player_team({}, *this, *player_team);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncItem)
-    {
-        auto sync_item = Terraria::Net::Packets::SyncItem::from_bytes(packet_bytes_stream);
-        m_server.client_did_sync_item({}, *this, *sync_item);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::SyncItemOwner)
-    {
-        auto sync_item_owner = Terraria::Net::Packets::SyncItemOwner::from_bytes(packet_bytes_stream);
-        m_server.client_did_sync_item_owner({}, *this, *sync_item_owner);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::PlaceObject)
-    {
-        auto place_object = Terraria::Net::Packets::PlaceObject::from_bytes(packet_bytes_stream);
-        m_server.client_did_place_object({}, *this, *place_object);
-    }
-    else if (packet_id == Terraria::Net::Packet::Id::ClientSyncedInventory)
+
+    if (m_inbound_start == m_inbound_end)
     {
-        // This packet has no data, and is completely useless.
+        m_inbound_start = 0;
+        m_inbound_end = 0;
     }
-    else
+}
+
+void Client::handle_packet(Terraria::Net::Packet::Id packet_id, ReadonlyBytes bytes)
+{
+    InputMemoryStream packet_bytes_stream(bytes);
+
+    auto timings = m_server.packet_dispatcher().dispatch(*this, packet_id, packet_bytes_stream);
+    if (!timings.has_value())
     {
         warnln("Unhandled packet {}", packet_id);
+
+        // Packets nothing handles are still counted, it's worth knowing what clients send that we ignore.
+        timings = Terraria::Net::PacketDispatcher<Client>::Timings{Time::zero(), Time::zero()};
     }
 
+    // The length and id in front of the packet are counted too, so inbound and outbound bytes add up the same.
+    m_packet_stats.record_inbound(packet_id, bytes.size() + 3, timings->decode_time, timings->handle_time);
+    m_server.packet_stats().record_inbound(packet_id, bytes.size() + 3, timings->decode_time, timings->handle_time);
+
     if (packet_bytes_stream.handle_any_error())
     {
         m_in_process_of_disconnecting = true;
@@ -371,11 +437,170 @@ void Client::on_ready_to_read()
     }
 }
 
+void Client::register_packet_handlers(Terraria::Net::PacketDispatcher<Client>& dispatcher)
+{
+    using namespace Terraria::Net::Packets;
+
+    // TODO: Some of these packets contain the player id, but we ignore that and assume it's the player id we assigned
+    // to this socket.
+
+    // Connection request, let's send a user slot
+    dispatcher.on<ConnectRequest>([](Client& client, ConnectRequest& request) {
+        client.m_server.client_did_connect_request({}, client, request.version());
+
+        SetUserSlot set_user_slot;
+        set_user_slot.set_player_id(client.m_id);
+        client.send(set_user_slot);
+    });
+
+    dispatcher.on<PlayerInfo>([](Client& client, PlayerInfo& player_info) {
+        client.m_player.character() = player_info.character();
+        outln("Got character, created player for {}", client.m_player.character().name());
+        client.m_server.client_did_send_player_info({}, client, player_info);
+    });
+
+    dispatcher.on<SyncInventorySlot>([](Client& client, SyncInventorySlot& inv_slot) {
+        if (inv_slot.item().id() == Terraria::Item::Id::None)
+            client.m_player.inventory().set_item(inv_slot.slot(), {});
+        else
+            client.m_player.inventory().set_item(inv_slot.slot(), inv_slot.item());
+        client.m_server.client_did_sync_inventory_slot({}, client, inv_slot);
+    });
+
+    dispatcher.on(Terraria::Net::Packet::Id::RequestWorldData, [](Client& client, InputMemoryStream&) {
+        client.m_server.client_did_request_world_data({}, client);
+    });
+
+    dispatcher.on_view<ClientUUID>([](Client& client, const ClientUUID::View& client_uuid) {
+        if (client_uuid.uuid().length() != 36)
+            warnln("Client sent UUID that isn't 36 characters.");
+        else
+            client.m_uuid = UUID(client_uuid.uuid());
+    });
+
+    dispatcher.on<PlayerHP>([](Client& client, PlayerHP& player_hp) {
+        client.m_player.set_hp(player_hp.hp());
+        client.m_player.set_max_hp(player_hp.max_hp());
+        client.m_server.client_did_sync_hp({}, client, player_hp);
+    });
+
+    dispatcher.on<PlayerBuffs>([](Client& client, PlayerBuffs& player_buffs) {
+        player_buffs.buffs().span().copy_to(client.m_player.buffs().span());
+        client.m_server.client_did_sync_buffs({}, client, player_buffs);
+    });
+
+    dispatcher.on<PlayerMana>([](Client& client, PlayerMana& player_mana) {
+        client.m_player.set_mana(player_mana.mana());
+        client.m_player.set_max_mana(player_mana.max_mana());
+        client.m_server.client_did_sync_mana({}, client, player_mana);
+    });
+
+    dispatcher.on<SpawnData>([](Client& client, SpawnData& spawn_data) {
+        client.m_server.client_did_request_spawn_sections({}, client, spawn_data);
+    });
+
+    dispatcher.on<SpawnPlayer>([](Client& client, SpawnPlayer& spawn_player) {
+        outln("Wants to spawn player, probably themselves. Fuck that, let's just tell them to finish.");
+        if (!client.m_has_finished_connecting)
+        {
+            client.m_server.client_did_finish_connecting({}, client);
+            ConnectFinished connect_finished;
+            client.send(connect_finished);
+            client.m_has_finished_connecting = true;
+        }
+        client.m_server.client_did_spawn_player({}, client, spawn_player);
+    });
+
+    dispatcher.on<SyncPlayer>([](Client& client, SyncPlayer& sync_player) {
+        auto& player = client.m_player;
+        player.set_control_bits(sync_player.control_bits());
+        player.set_bits_2(sync_player.bits_2());
+        player.set_bits_3(sync_player.bits_3());
+        player.set_bits_4(sync_player.bits_4());
+        player.inventory().set_selected_slot(static_cast<Terraria::PlayerInventory::Slot>(sync_player.selected_item()));
+        player.position() = sync_player.position();
+        if (sync_player.velocity().has_value())
+            player.velocity() = *sync_player.velocity();
+        // TODO: Do something with potion of return use and home position
+        client.m_server.client_did_sync_player({}, client, sync_player);
+    });
+
+    dispatcher.on<SyncProjectile>([](Client& client, SyncProjectile& proj) {
+        client.m_server.client_did_sync_projectile({}, client, proj);
+    });
+
+    dispatcher.on_module_view<Modules::Text>([](Client& client, const Modules::Text::View& text) {
+        if (text.command_name() == "Say"sv)
+            client.m_server.client_did_send_message({}, client, text.message().to_string());
+    });
+
+    dispatcher.on<KillProjectile>([](Client& client, KillProjectile& kill_proj) {
+        client.m_server.client_did_kill_projectile({}, client, kill_proj);
+    });
+
+    dispatcher.on<TogglePvp>([](Client& client, TogglePvp& toggle_pvp) {
+        client.m_server.client_did_toggle_pvp({}, client, toggle_pvp);
+    });
+
+    dispatcher.on<PlayerHurt>([](Client& client, PlayerHurt& player_hurt) {
+        client.m_server.client_did_hurt_player({}, client, player_hurt);
+    });
+
+    dispatcher.on<PlayerDeath>([](Client& client, PlayerDeath& player_death) {
+        client.m_server.client_did_player_death({}, client, player_death);
+    });
+
+    dispatcher.on<DamageNPC>([](Client& client, DamageNPC& damage_npc) {
+        client.m_server.client_did_damage_npc({}, client, damage_npc);
+    });
+
+    // This is only ever relayed as it was received, so there's no point decoding it.
+    dispatcher.on_view<PlayerItemAnimation>([](Client& client, const PlayerItemAnimation::View& item_anim) {
+        client.m_server.client_did_item_animation({}, client, item_anim);
+    });
+
+    dispatcher.on<ModifyTile>([](Client& client, ModifyTile& modify_tile) {
+        client.m_server.client_did_modify_tile({}, client, modify_tile);
+    });
+
+    // Same for this one.
+    dispatcher.on_view<SyncTilePicking>([](Client& client, const SyncTilePicking::View& sync_tile_picking) {
+        client.m_server.client_did_sync_tile_picking({}, client, sync_tile_picking);
+    });
+
+    dispatcher.on<AddPlayerBuff>([](Client& client, AddPlayerBuff& add_player_buff) {
+        client.m_server.client_did_add_player_buff({}, client, add_player_buff);
+    });
+
+    dispatcher.on<SyncTalkNPC>([](Client& client, SyncTalkNPC& sync_talk_npc) {
+        client.m_server.client_did_sync_talk_npc({}, client, sync_talk_npc);
+    });
+
+    dispatcher.on<PlayerTeam>([](Client& client, PlayerTeam& player_team) {
+        client.m_server.client_did_sync_player_team({}, client, player_team);
+    });
+
+    dispatcher.on<SyncItem>([](Client& client, SyncItem& sync_item) {
+        client.m_server.client_did_sync_item({}, client, sync_item);
+    });
+
+    dispatcher.on<SyncItemOwner>([](Client& client, SyncItemOwner& sync_item_owner) {
+        client.m_server.client_did_sync_item_owner({}, client, sync_item_owner);
+    });
+
+    dispatcher.on<PlaceObject>([](Client& client, PlaceObject& place_object) {
+        client.m_server.client_did_place_object({}, client, place_object);
+    });
+
+    // This packet has no data, and is completely useless.
+    dispatcher.on(Terraria::Net::Packet::Id::ClientSyncedInventory, [](Client&, InputMemoryStream&) {});
+}
+
 void Client::send_keep_alive()
 {
     // This is our way of keeping the client connection alive
     // The client will think the server has disconnected after 7200 ticks (120 seconds) of no data received.
     // Packet ID 0 is unused, so we just send it as bogus, and it knows we're still here.
-    m_stream << static_cast<u16>(3);
-    m_stream << static_cast<u8>(0);
+    static constexpr u8 bogus_packet_id = 0;
+    send_encoded(EncodedPacket::create({&bogus_packet_id, 1}));
 }
\ No newline at end of file
@@ -9,12 +9,17 @@
 #include <AK/RefCounted.h>
 #include <AK/UUID.h>
 #include <AK/WeakPtr.h>
+#include <LibCore/ElapsedTimer.h>
+#include <LibCore/Notifier.h>
 #include <LibCore/TCPSocket.h>
 #include <LibCore/Timer.h>
 #include <LibTerraria/Net/NetworkText.h>
 #include <LibTerraria/Net/Packet.h>
+#include <LibTerraria/Net/PacketDispatcher.h>
 #include <LibTerraria/Player.h>
-#include <Server/SocketStream.h>
+#include <Server/BufferPool.h>
+#include <Server/EncodedPacket.h>
+#include <Server/PacketStats.h>
 
 class Server;
 
@@ -25,7 +30,42 @@ public:
     {
         EofReached, // The TCP socket reached EOF
         DisconnectedByServer,
-        StreamErrored
+        StreamErrored,
+        // We had more queued up to send than the client was taking, for too long
+        TooSlow
+    };
+
+    // Low priority packets are ones the next of their kind makes redundant (like another player's position), so they
+    // can be dropped for a client that isn't keeping up.
+    enum class Priority
+    {
+        Normal,
+        Low
+    };
+
+    // Once this much is queued up for a client, it's congested and low priority packets are dropped, until it gets
+    // back under the low watermark.
+    static constexpr size_t outbound_high_watermark = 2 * MiB;
+    static constexpr size_t outbound_low_watermark = 256 * KiB;
+    // A client is disconnected as soon as it has more than this queued up, or if it stays congested for too long.
+    static constexpr size_t outbound_limit = 16 * MiB;
+    static constexpr i64 outbound_congestion_timeout_ms = 30'000;
+    // How many queued packets are handed to a single sendmsg() at most.
+    static constexpr size_t max_packets_per_send = 64;
+
+    // Enough to hold the largest frame there can be, whose size is a u16.
+    static constexpr size_t inbound_capacity = 64 * KiB;
+    // How many frames are handled in one go, before giving everybody else a turn.
+    static constexpr size_t max_frames_per_read = 64;
+
+    struct OutboundStats
+    {
+        u64 sent_bytes{};
+        u64 sent_packets{};
+        // How many sendmsg() calls it took to send them.
+        u64 send_calls{};
+        size_t max_queued_bytes{};
+        u32 dropped_packets{};
     };
 
     Client(NonnullRefPtr<Core::TCPSocket> socket, Server& server, u8 id);
@@ -38,7 +78,24 @@ public:
 
     IPv4Address address() const { return m_socket->source_address().ipv4_address(); }
 
-    void send(const Terraria::Net::Packet&);
+    // Packets are queued up and written out together once the event loop gets around to it, or as the socket is ready
+    // for them, so these never block.
+    void send(const Terraria::Net::Packet&, Priority = Priority::Normal);
+
+    // Sends a packet that has already been turned into bytes, which can be shared with any other client.
+    void send_encoded(NonnullRefPtr<EncodedPacket>, Priority = Priority::Normal);
+
+    size_t queued_bytes() const { return m_queued_bytes; }
+
+    bool is_congested() const { return m_congested; }
+
+    const OutboundStats& outbound_stats() const { return m_outbound_stats; }
+
+    // Just this client's packets, the server counts everybody's together too.
+    const PacketStats& packet_stats() const { return m_packet_stats; }
+
+    // Writes out as much of what's queued up as the socket will take.
+    void flush_outbound();
 
     void disconnect(const Terraria::Net::NetworkText&);
 
@@ -48,20 +105,62 @@ public:
 
     void full_sync(Client& to);
 
+    // Just the part of full_sync() that moves the player around, which is what gets dropped while they're out of range.
+    void sync_position(Client& to);
+
     const Optional<UUID>& uuid() const { return m_uuid; }
 
+    // Everything a client can send us, and what we do when it does.
+    static void register_packet_handlers(Terraria::Net::PacketDispatcher<Client>&);
+
+    // Which tile sections this client has been sent, or are on their way to it, indexed like TileSectionCache's.
+    Vector<bool>& sent_sections() { return m_sent_sections; }
+
+    // The section the player was in the last time we streamed the sections around them.
+    Optional<Terraria::TilePoint>& streamed_around_section() { return m_streamed_around_section; }
+
 private:
     void on_ready_to_read();
 
+    void handle_inbound_frames();
+
+    void handle_packet(Terraria::Net::Packet::Id, ReadonlyBytes);
+
     void send_keep_alive();
 
+    void update_congestion();
+
+    void outbound_did_fail(DisconnectReason);
+
     Server& m_server;
     NonnullRefPtr<Core::TCPSocket> m_socket;
-    SocketStream m_stream;
     Terraria::Player m_player;
     Optional<UUID> m_uuid;
+    Vector<bool> m_sent_sections;
+    Optional<Terraria::TilePoint> m_streamed_around_section;
     u8 m_id;
     bool m_has_finished_connecting{};
     bool m_in_process_of_disconnecting{};
     RefPtr<Core::Timer> m_keep_alive_timer;
+
+    // Everything read from the socket that hasn't been handled yet is [m_inbound_start, m_inbound_end).
+    PooledBuffer m_inbound;
+    size_t m_inbound_start{};
+    size_t m_inbound_end{};
+    bool m_inbound_continuation_scheduled{};
+
+    // Everything before m_outbound_head has been sent already, and is only compacted away once it's at least half of
+    // the queue, so that draining a long backlog doesn't keep shifting the rest of it down. The packet at the head may
+    // have been partially written.
+    Vector<NonnullRefPtr<EncodedPacket>> m_outbound;
+    size_t m_outbound_head{};
+    size_t m_outbound_offset{};
+    bool m_flush_scheduled{};
+    size_t m_queued_bytes{};
+    bool m_congested{};
+    bool m_outbound_failed{};
+    Core::ElapsedTimer m_congested_timer;
+    RefPtr<Core::Notifier> m_write_notifier;
+    OutboundStats m_outbound_stats;
+    PacketStats m_packet_stats;
 };
\ No newline at end of file
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/NonnullRefPtr.h>
+#include <AK/RefCounted.h>
+#include <AK/Span.h>
+#include <LibTerraria/Net/Packet.h>
+#include <Server/BufferPool.h>
+
+// A packet that has been turned into bytes once, with its length in front of it, so it can be queued up on any number
+// of clients as-is. It never changes once it's been created, and its bytes go back to the BufferPool once nobody
+// needs them anymore.
+class EncodedPacket : public RefCounted<EncodedPacket>
+{
+public:
+    // The bytes are everything but the length, like Packet::to_bytes() gives back.
+    static NonnullRefPtr<EncodedPacket> create(ReadonlyBytes packet_bytes)
+    {
+        PooledBuffer buffer(packet_bytes.size() + 2);
+        write_length(buffer);
+        buffer.bytes().overwrite(2, packet_bytes.data(), packet_bytes.size());
+        return adopt_ref(*new EncodedPacket(move(buffer)));
+    }
+
+    // For relaying a packet as it was received, without decoding it first.
+    static NonnullRefPtr<EncodedPacket> create(Terraria::Net::Packet::Id id, ReadonlyBytes payload)
+    {
+        PooledBuffer buffer(payload.size() + 3);
+        write_length(buffer);
+        buffer.data()[2] = static_cast<u8>(id);
+        buffer.bytes().overwrite(3, payload.data(), payload.size());
+        return adopt_ref(*new EncodedPacket(move(buffer)));
+    }
+
+    static NonnullRefPtr<EncodedPacket> create(const Terraria::Net::Packet& packet)
+    {
+        // Most packets know how big they'll be, so they can be written right where they'll stay.
+        auto size = packet.encoded_size();
+        if (!size.has_value())
+            return create(packet.to_bytes());
+
+        PooledBuffer buffer(*size);
+        packet.encode_into(buffer.bytes());
+        return adopt_ref(*new EncodedPacket(move(buffer)));
+    }
+
+    ReadonlyBytes bytes() const { return m_buffer.bytes(); }
+
+    size_t size() const { return m_buffer.size(); }
+
+    Terraria::Net::Packet::Id id() const { return static_cast<Terraria::Net::Packet::Id>(m_buffer.data()[2]); }
+
+private:
+    explicit EncodedPacket(PooledBuffer buffer) : m_buffer(move(buffer)) {}
+
+    static void write_length(PooledBuffer& buffer)
+    {
+        u16 length = buffer.size();
+        buffer.data()[0] = length & 0xFF;
+        buffer.data()[1] = length >> 8;
+    }
+
+    const PooledBuffer m_buffer;
+};
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Server/InterestGrid.h>
+
+InterestGrid::InterestGrid(u16 width_in_tiles, u16 height_in_tiles)
+    : m_cells_wide(max((width_in_tiles * 16 + cell_width - 1) / cell_width, 1)),
+      m_cells_tall(max((height_in_tiles * 16 + cell_height - 1) / cell_height, 1))
+{
+    m_clients_in_cell.resize(m_cells_wide * m_cells_tall);
+}
+
+InterestGrid::Cell InterestGrid::cell_at(const Terraria::EntityPoint& position) const
+{
+    // Players can end up (or say they are) just about anywhere, so anything off of the world is kept to its edge.
+    return {Terraria::clamp_to_int(position.x() / cell_width, 0, m_cells_wide - 1),
+            Terraria::clamp_to_int(position.y() / cell_height, 0, m_cells_tall - 1)};
+}
+
+Vector<u8> InterestGrid::update(u8 client_id, const Terraria::EntityPoint& position)
+{
+    auto new_cell = cell_at(position);
+    auto& old_cell = m_cell_of_client[client_id];
+    if (old_cell.has_value() && old_cell->x == new_cell.x && old_cell->y == new_cell.y)
+        return {};
+
+    Vector<u8> came_into_range;
+    for_each_cell_in_view(new_cell, [&](size_t cell) {
+        for (auto other_id : m_clients_in_cell[cell])
+        {
+            if (other_id == client_id)
+                continue;
+
+            if (!old_cell.has_value() || !are_in_view(*old_cell, *m_cell_of_client[other_id]))
+                came_into_range.append(other_id);
+        }
+    });
+
+    if (old_cell.has_value())
+        m_clients_in_cell[index_of(*old_cell)].remove_first_matching([&](auto id) { return id == client_id; });
+
+    m_clients_in_cell[index_of(new_cell)].append(client_id);
+    old_cell = new_cell;
+
+    return came_into_range;
+}
+
+void InterestGrid::remove(u8 client_id)
+{
+    auto& cell = m_cell_of_client[client_id];
+    if (!cell.has_value())
+        return;
+
+    m_clients_in_cell[index_of(*cell)].remove_first_matching([&](auto id) { return id == client_id; });
+    cell.clear();
+}
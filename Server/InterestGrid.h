@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <LibTerraria/Point.h>
+
+// A uniform grid over the world that keeps track of which cell every player is in, so that whatever only a nearby
+// player could see can be sent to just the players around it, instead of to everybody.
+// A client is interested in everything within view distance of the cell it's in, and one we don't know the position of
+// yet isn't interested in anything.
+class InterestGrid
+{
+public:
+    // Cells are as big as a tile section, in pixels like every EntityPoint.
+    static constexpr int cell_width = 200 * 16;
+    static constexpr int cell_height = 150 * 16;
+    static constexpr int view_distance_cells_x = 1;
+    static constexpr int view_distance_cells_y = 1;
+
+    InterestGrid(u16 width_in_tiles, u16 height_in_tiles);
+
+    // Moves the client to wherever this position is, and returns every other client that it's now in range of, but
+    // wasn't before.
+    Vector<u8> update(u8 client_id, const Terraria::EntityPoint&);
+
+    void remove(u8 client_id);
+
+    // Calls back with the id of every client interested in this position.
+    template<typename Callback>
+    void for_each_interested(const Terraria::EntityPoint& position, Callback callback) const
+    {
+        for_each_cell_in_view(cell_at(position), [&](size_t cell) {
+            for (auto client_id : m_clients_in_cell[cell])
+                callback(client_id);
+        });
+    }
+
+private:
+    struct Cell
+    {
+        int x;
+        int y;
+    };
+
+    Cell cell_at(const Terraria::EntityPoint&) const;
+
+    ALWAYS_INLINE size_t index_of(const Cell& cell) const { return cell.x + (m_cells_wide * cell.y); }
+
+    template<typename Callback>
+    void for_each_cell_in_view(const Cell& center, Callback callback) const
+    {
+        auto first_x = max(center.x - view_distance_cells_x, 0);
+        auto first_y = max(center.y - view_distance_cells_y, 0);
+        auto last_x = min(center.x + view_distance_cells_x, m_cells_wide - 1);
+        auto last_y = min(center.y + view_distance_cells_y, m_cells_tall - 1);
+        for (auto y = first_y; y <= last_y; y++)
+        {
+            for (auto x = first_x; x <= last_x; x++)
+                callback(index_of({x, y}));
+        }
+    }
+
+    static bool are_in_view(const Cell& a, const Cell& b)
+    {
+        return max(a.x, b.x) - min(a.x, b.x) <= view_distance_cells_x &&
+               max(a.y, b.y) - min(a.y, b.y) <= view_distance_cells_y;
+    }
+
+    int m_cells_wide;
+    int m_cells_tall;
+    Vector<Vector<u8>> m_clients_in_cell;
+    Array<Optional<Cell>, 256> m_cell_of_client;
+};
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Array.h>
+#include <AK/OwnPtr.h>
+#include <AK/Time.h>
+#include <AK/Types.h>
+#include <LibTerraria/Net/Packet.h>
+
+// How many packets of every id went in and out, how big they were, and how long they took to decode, handle and
+// encode. The server keeps one for everything, and every client keeps its own.
+class PacketStats
+{
+public:
+    enum class Direction : u8
+    {
+        Inbound,
+        Outbound
+    };
+
+    // Bucket n holds everything that took less than 2^n microseconds, the last one holds everything slower.
+    class Histogram
+    {
+    public:
+        static constexpr size_t bucket_count = 16;
+
+        void record(const Time& duration)
+        {
+            auto microseconds = static_cast<u64>(max<i64>(duration.to_microseconds(), 0));
+            size_t bucket = 0;
+            while (bucket < bucket_count - 1 && microseconds >= (1ull << bucket))
+                bucket++;
+
+            m_buckets[bucket]++;
+            m_count++;
+            m_total_microseconds += microseconds;
+        }
+
+        const Array<u64, bucket_count>& buckets() const { return m_buckets; }
+
+        u64 count() const { return m_count; }
+
+        u64 total_microseconds() const { return m_total_microseconds; }
+
+    private:
+        Array<u64, bucket_count> m_buckets{};
+        u64 m_count{};
+        u64 m_total_microseconds{};
+    };
+
+    struct Counters
+    {
+        u64 packets{};
+        u64 bytes{};
+
+        // Only inbound packets are decoded and handled, and only outbound ones are encoded.
+        Histogram decode_time;
+        Histogram handle_time;
+        Histogram encode_time;
+    };
+
+    void record_inbound(Terraria::Net::Packet::Id id, size_t bytes, const Time& decode_time, const Time& handle_time)
+    {
+        auto& counters = ensure_counters(Direction::Inbound, id);
+        counters.packets++;
+        counters.bytes += bytes;
+        counters.decode_time.record(decode_time);
+        counters.handle_time.record(handle_time);
+    }
+
+    void record_outbound(Terraria::Net::Packet::Id id, size_t bytes)
+    {
+        auto& counters = ensure_counters(Direction::Outbound, id);
+        counters.packets++;
+        counters.bytes += bytes;
+    }
+
+    // Packets that are broadcast are only encoded once, however many clients they go to.
+    void record_encode(Terraria::Net::Packet::Id id, const Time& encode_time)
+    {
+        ensure_counters(Direction::Outbound, id).encode_time.record(encode_time);
+    }
+
+    // Only the ids that have been seen are visited, in order.
+    template<typename Callback>
+    void for_each(Direction direction, Callback callback) const
+    {
+        auto& counters = direction == Direction::Inbound ? m_inbound : m_outbound;
+        for (size_t id = 0; id < counters.size(); id++)
+        {
+            if (counters[id])
+                callback(static_cast<Terraria::Net::Packet::Id>(id), *counters[id]);
+        }
+    }
+
+private:
+    Counters& ensure_counters(Direction direction, Terraria::Net::Packet::Id id)
+    {
+        auto& counters = (direction == Direction::Inbound ? m_inbound : m_outbound)[static_cast<u8>(id)];
+        if (!counters)
+            counters = make<Counters>();
+        return *counters;
+    }
+
+    // Most ids are never seen, so there's no point in every client having room for all of them.
+    Array<OwnPtr<Counters>, 256> m_inbound;
+    Array<OwnPtr<Counters>, 256> m_outbound;
+};
@@ -36,11 +36,14 @@ Engine::Engine(Server& server) : m_server(server)
     static const struct luaL_Reg game_lib[] = {
         {"client", game_client_thunk},
         {"clients", game_clients_thunk},
+        {"clientsNear", game_clients_near_thunk},
         {"addProjectile", game_add_projectile_thunk},
         {"addDroppedItem", game_add_dropped_item_thunk},
         {"removeDroppedItem", game_remove_dropped_item_thunk},
         {"setItemOwner", game_set_item_owner_thunk},
         {"nextAvailableDroppedItemId", game_next_available_dropped_item_id_thunk},
+        {"broadcastMessage", game_broadcast_message_thunk},
+        {"stats", game_stats_thunk},
         {}};
 
     static const struct luaL_Reg timer_lib[] = {
@@ -62,6 +65,7 @@ Engine::Engine(Server& server) : m_server(server)
                                                  {"syncTileRect", client_sync_tile_rect_thunk},
                                                  {"modifyTile", client_modify_tile_thunk},
                                                  {"uuid", client_uuid_thunk},
+                                                 {"stats", client_stats_thunk},
                                                  {}};
 
     static const struct luaL_Reg player_lib[] = {{"character", player_character_thunk},
@@ -199,7 +203,7 @@ void Engine::client_did_sync_projectile(Badge<Server>, const Client& who,
     UsingBaseTable base(*this);
     lua_getfield(m_state, -1, "onClientSyncProjectile");
     client_userdata(who.id());
-    Types::projectile(m_state, proj_sync.projectile());
+    Types::projectile(m_state, Terraria::Projectile::from_packet(proj_sync));
     lua_call(m_state, 2, 0);
 }
 
@@ -545,6 +549,22 @@ int Engine::game_clients()
     return 1;
 }
 
+int Engine::game_clients_near()
+{
+    auto position = Types::point(m_state, 1);
+    lua_newtable(m_state);
+    m_server.interest_grid().for_each_interested(position, [&](u8 id) {
+        auto client = m_server.client(id);
+        if (!client || client->in_process_of_disconnecting())
+            return;
+
+        client_userdata(id);
+        lua_rawseti(m_state, -2, id + 1);
+    });
+
+    return 1;
+}
+
 int Engine::game_add_projectile()
 {
     int is_integer = false;
@@ -608,8 +628,7 @@ int Engine::game_set_item_owner()
     sync_item_owner.set_item_id(id);
     sync_item_owner.set_player_id(owner);
 
-    for (auto& client : m_server.clients())
-        client->send(sync_item_owner);
+    m_server.broadcast(sync_item_owner);
 
     m_server.dropped_items().set(id, move(item));
 
@@ -623,6 +642,32 @@ int Engine::game_next_available_dropped_item_id()
     return 1;
 }
 
+int Engine::game_broadcast_message()
+{
+    auto text = luaL_checkstring(m_state, 1);
+    auto author = luaL_optinteger(m_state, 2, 255);
+    Terraria::Color col;
+    if (lua_type(m_state, 3) == LUA_TTABLE)
+        col = Types::color(m_state, 3);
+    else
+        col = {255, 255, 255};
+
+    Terraria::Net::Packets::Modules::Text text_packet;
+    text_packet.set_text(text);
+    text_packet.set_author(author);
+    text_packet.set_color(col);
+
+    m_server.broadcast(text_packet, {}, [](const Client& client) { return !client.in_process_of_disconnecting(); });
+
+    return 0;
+}
+
+int Engine::game_stats()
+{
+    Types::packet_stats(m_state, m_server.packet_stats());
+    return 1;
+}
+
 int Engine::client_id()
 {
     lua_pushinteger(m_state, *reinterpret_cast<u8*>(luaL_checkudata(m_state, 1, "Server::Client")));
@@ -703,10 +748,7 @@ int Engine::client_sync_projectile()
     if (!proj.has_value())
         return 0;
 
-    Terraria::Net::Packets::SyncProjectile sync_proj;
-    sync_proj.projectile() = *proj;
-
-    client->send(sync_proj);
+    client->send(proj->to_packet());
 
     return 0;
 }
@@ -749,8 +791,7 @@ int Engine::player_update_character()
     player_info.set_player_id(client->id());
     player_info.set_character(character);
 
-    for (auto& c : m_server.clients())
-        c->send(player_info);
+    m_server.broadcast(player_info);
 
     return 0;
 }
@@ -828,15 +869,9 @@ int Engine::client_modify_tile()
     Terraria::Net::Packets::ModifyTile modify_tile;
     modify_tile.modification() = modification;
 
-    for (auto& kv : m_server.clients())
-    {
-        if (kv->id() == client->id())
-            continue;
-
-        kv->send(modify_tile);
-    }
+    m_server.broadcast(modify_tile, client->id());
 
-    m_server.tile_map().process_tile_modification(modification);
+    m_server.modify_tile(modification);
 
     return 0;
 }
@@ -852,6 +887,17 @@ int Engine::client_uuid()
     return 1;
 }
 
+int Engine::client_stats()
+{
+    auto client = m_server.client(*reinterpret_cast<u8*>(luaL_checkudata(m_state, 1, "Server::Client")));
+    if (!client)
+        lua_pushnil(m_state);
+    else
+        Types::packet_stats(m_state, client->packet_stats());
+
+    return 1;
+}
+
 int Engine::player_set_pvp()
 {
     auto client = m_server.client(*reinterpret_cast<u8*>(luaL_checkudata(m_state, 1, "Terraria::Player")));
@@ -867,13 +913,7 @@ int Engine::player_set_pvp()
 
     auto syncToSelf = lua_toboolean(m_state, 3);
 
-    for (auto& c : m_server.clients())
-    {
-        if (!syncToSelf && c->id() == client->id())
-            continue;
-
-        c->send(toggle_pvp);
-    }
+    m_server.broadcast(toggle_pvp, syncToSelf ? Optional<u8>{} : client->id());
 
     return 0;
 }
@@ -906,8 +946,7 @@ int Engine::player_teleport()
     teleport_entity.position() = pos;
     teleport_entity.set_style(luaL_optinteger(m_state, 3, 0));
 
-    for (auto& c : m_server.clients())
-        c->send(teleport_entity);
+    m_server.broadcast(teleport_entity);
 
     return 0;
 }
@@ -930,13 +969,7 @@ int Engine::player_set_team()
 
     auto syncToSelf = lua_toboolean(m_state, 3);
 
-    for (auto& c : m_server.clients())
-    {
-        if (!syncToSelf && c->id() == client->id())
-            continue;
-
-        c->send(player_team);
-    }
+    m_server.broadcast(player_team, syncToSelf ? Optional<u8>{} : client->id());
 
     return 0;
 }
@@ -962,13 +995,7 @@ int Engine::player_set_health()
 
     auto syncToSelf = lua_toboolean(m_state, 4);
 
-    for (auto& c : m_server.clients())
-    {
-        if (!syncToSelf && c->id() == client->id())
-            continue;
-
-        c->send(player_hp);
-    }
+    m_server.broadcast(player_hp, syncToSelf ? Optional<u8>{} : client->id());
 
     return 0;
 }
@@ -994,13 +1021,7 @@ int Engine::player_set_mana()
 
     auto syncToSelf = lua_toboolean(m_state, 4);
 
-    for (auto& c : m_server.clients())
-    {
-        if (!syncToSelf && c->id() == client->id())
-            continue;
-
-        c->send(player_mana);
-    }
+    m_server.broadcast(player_mana, syncToSelf ? Optional<u8>{} : client->id());
 
     return 0;
 }
@@ -1057,8 +1078,7 @@ int Engine::player_set_item_in_slot()
     else
         inv_slot.item() = Terraria::Item(Terraria::Item::Id::None);
 
-    for (auto& c : m_server.clients())
-        c->send(inv_slot);
+    m_server.broadcast(inv_slot);
 
     return 0;
 }
@@ -110,6 +110,8 @@ private:
 
     DEFINE_LUA_METHOD(game_clients);
 
+    DEFINE_LUA_METHOD(game_clients_near);
+
     DEFINE_LUA_METHOD(game_add_projectile);
 
     DEFINE_LUA_METHOD(game_add_dropped_item);
@@ -120,6 +122,10 @@ private:
 
     DEFINE_LUA_METHOD(game_next_available_dropped_item_id);
 
+    DEFINE_LUA_METHOD(game_broadcast_message);
+
+    DEFINE_LUA_METHOD(game_stats);
+
     // Client
     DEFINE_LUA_METHOD(client_id);
 
@@ -147,6 +153,8 @@ private:
 
     DEFINE_LUA_METHOD(client_uuid);
 
+    DEFINE_LUA_METHOD(client_stats);
+
     // Player
     DEFINE_LUA_METHOD(player_character);
 
@@ -789,4 +789,76 @@ Terraria::DroppedItem Types::dropped_item(lua_State* state, int index)
 
     return dropped_item;
 }
-}
\ No newline at end of file
+
+static void push_histogram(lua_State* state, const PacketStats::Histogram& histogram)
+{
+    lua_createtable(state, 0, 3);
+
+    lua_pushstring(state, "count");
+    lua_pushinteger(state, histogram.count());
+    lua_settable(state, -3);
+
+    lua_pushstring(state, "totalMicroseconds");
+    lua_pushinteger(state, histogram.total_microseconds());
+    lua_settable(state, -3);
+
+    // Bucket n (counting from 1, like Lua does) holds everything that took less than 2^(n - 1) microseconds.
+    lua_pushstring(state, "buckets");
+    lua_createtable(state, histogram.buckets().size(), 0);
+    for (size_t i = 0; i < histogram.buckets().size(); i++)
+    {
+        lua_pushinteger(state, histogram.buckets()[i]);
+        lua_rawseti(state, -2, i + 1);
+    }
+    lua_settable(state, -3);
+}
+
+static void push_packet_counters(lua_State* state, const PacketStats& stats, PacketStats::Direction direction)
+{
+    lua_newtable(state);
+    stats.for_each(direction, [&](auto id, auto& counters) {
+        lua_createtable(state, 0, 4);
+
+        lua_pushstring(state, "packets");
+        lua_pushinteger(state, counters.packets);
+        lua_settable(state, -3);
+
+        lua_pushstring(state, "bytes");
+        lua_pushinteger(state, counters.bytes);
+        lua_settable(state, -3);
+
+        if (direction == PacketStats::Direction::Inbound)
+        {
+            lua_pushstring(state, "decodeTime");
+            push_histogram(state, counters.decode_time);
+            lua_settable(state, -3);
+
+            lua_pushstring(state, "handleTime");
+            push_histogram(state, counters.handle_time);
+            lua_settable(state, -3);
+        }
+        else
+        {
+            lua_pushstring(state, "encodeTime");
+            push_histogram(state, counters.encode_time);
+            lua_settable(state, -3);
+        }
+
+        // Keyed by the packet id itself, not an index.
+        lua_rawseti(state, -2, static_cast<u8>(id));
+    });
+}
+
+void Types::packet_stats(lua_State* state, const PacketStats& value)
+{
+    lua_createtable(state, 0, 2);
+
+    lua_pushstring(state, "inbound");
+    push_packet_counters(state, value, PacketStats::Direction::Inbound);
+    lua_settable(state, -3);
+
+    lua_pushstring(state, "outbound");
+    push_packet_counters(state, value, PacketStats::Direction::Outbound);
+    lua_settable(state, -3);
+}
+}
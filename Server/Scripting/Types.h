@@ -14,6 +14,7 @@
 #include <LibTerraria/PlayerDeathReason.h>
 #include <LibTerraria/Projectile.h>
 #include <LibTerraria/TileModification.h>
+#include <Server/PacketStats.h>
 
 typedef struct lua_State lua_State;
 
@@ -57,5 +58,8 @@ public:
     static void dropped_item(lua_State*, const Terraria::DroppedItem&);
 
     static Terraria::DroppedItem dropped_item(lua_State*, int index);
+
+    // There's no going the other way, scripts only get to look at these.
+    static void packet_stats(lua_State*, const PacketStats&);
 };
 }
\ No newline at end of file
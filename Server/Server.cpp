@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+#include <AK/Time.h>
+#include <LibCore/ElapsedTimer.h>
 #include <LibTerraria/Model.h>
 #include <LibTerraria/Net/Packets/Modules/Text.h>
 #include <LibTerraria/Net/Packets/PlayerActive.h>
@@ -12,16 +14,24 @@
 #include <LibTerraria/Net/Packets/SyncPlayer.h>
 #include <LibTerraria/Net/Packets/SyncTileRect.h>
 #include <LibTerraria/Net/Packets/TileFrameSection.h>
-#include <LibTerraria/Net/Packets/TileSection.h>
 #include <LibTerraria/Net/Packets/WorldData.h>
 #include <Server/Scripting/Engine.h>
 #include <Server/Server.h>
 
+// FIXME: Do what Serenity does with their debug macros
+#define OUTBOUND_DEBUG 0
+
+// FIXME: Do what Serenity does with their debug macros
+#define BUFFER_POOL_DEBUG 0
+
 constexpr i16 s_max_dropped_items = 400;
 
 Server::Server(RefPtr<Terraria::World> world) : m_server(Core::TCPServer::construct()), m_world(world)
 {
     m_engine = make<Scripting::Engine>(*this);
+    m_tile_section_cache = make<TileSectionCache>(tile_map(), 200, 150, m_event_loop);
+    m_interest_grid = make<InterestGrid>(tile_map().width(), tile_map().height());
+    Client::register_packet_handlers(m_packet_dispatcher);
     m_server->on_ready_to_accept = [this] {
         auto socket = m_server->accept();
         if (!socket)
@@ -66,17 +76,45 @@ void Server::client_did_connect_request(Badge<Client>, const Client& client, con
     m_engine->client_did_connect_request({}, client, version);
 }
 
-void Server::client_did_sync_player(Badge<Client>, const Client& who, Terraria::Net::Packets::SyncPlayer& sync_player)
+void Server::client_did_sync_player(Badge<Client>, Client& who, Terraria::Net::Packets::SyncPlayer& sync_player)
 {
     if (!who.has_finished_connecting())
         return;
 
-    for (auto& kv : m_clients)
+    // Positions are in pixels, and every tile is 16 of them.
+    auto tile_x = Terraria::clamp_to_int(sync_player.position().x() / 16, 0, tile_map().width() - 1);
+    auto tile_y = Terraria::clamp_to_int(sync_player.position().y() / 16, 0, tile_map().height() - 1);
+    Terraria::TilePoint tile{static_cast<u16>(tile_x), static_cast<u16>(tile_y)};
+
+    Terraria::TilePoint section{static_cast<u16>(tile.x() / m_tile_section_cache->section_width()),
+                                static_cast<u16>(tile.y() / m_tile_section_cache->section_height())};
+    auto& streamed_around_section = who.streamed_around_section();
+    if (!streamed_around_section.has_value() || *streamed_around_section != section)
+        stream_sections_around(who, tile);
+
+    for (auto other_id : m_interest_grid->update(who.id(), sync_player.position()))
     {
-        if (kv.key == who.id())
-            continue;
+        auto other = m_clients.find(other_id);
+        if (other != m_clients.end())
+            players_did_come_into_range(who, *other->value);
+    }
+
+    broadcast_near(sync_player, sync_player.position(), who.id(), Client::Priority::Low);
+}
 
-        kv.value->send(sync_player);
+void Server::players_did_come_into_range(Client& first, Client& second)
+{
+    first.sync_position(second);
+    second.sync_position(first);
+
+    for (auto& kv : m_projectiles)
+    {
+        auto sync_projectile = kv.value.to_packet();
+
+        if (kv.value.owner() == first.id())
+            second.send(sync_projectile);
+        else if (kv.value.owner() == second.id())
+            first.send(sync_projectile);
     }
 }
 
@@ -85,13 +123,7 @@ void Server::client_did_send_player_info(Badge<Client>, Client& who, const Terra
     if (!who.has_finished_connecting())
         return;
 
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(info);
-    }
+    broadcast(info, who.id());
 }
 
 void Server::client_did_request_world_data(Badge<Client>, Client& who)
@@ -136,13 +168,7 @@ void Server::client_did_request_world_data(Badge<Client>, Client& who)
 
 void Server::client_did_spawn_player(Badge<Client>, Client& client, const Terraria::Net::Packets::SpawnPlayer& spawn)
 {
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == client.id())
-            continue;
-
-        kv.value->send(spawn);
-    }
+    broadcast(spawn, client.id());
 
     m_engine->client_did_spawn_player({}, client, spawn);
 }
@@ -152,13 +178,7 @@ void Server::client_did_sync_mana(Badge<Client>, Client& who, const Terraria::Ne
     if (!who.has_finished_connecting())
         return;
 
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(player_mana);
-    }
+    broadcast(player_mana, who.id());
 }
 
 void Server::client_did_sync_hp(Badge<Client>, Client& who, const Terraria::Net::Packets::PlayerHP& player_hp)
@@ -166,13 +186,7 @@ void Server::client_did_sync_hp(Badge<Client>, Client& who, const Terraria::Net:
     if (!who.has_finished_connecting())
         return;
 
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(player_hp);
-    }
+    broadcast(player_hp, who.id());
 }
 
 void Server::client_did_sync_buffs(Badge<Client>, Client& who, const Terraria::Net::Packets::PlayerBuffs& buffs)
@@ -180,13 +194,7 @@ void Server::client_did_sync_buffs(Badge<Client>, Client& who, const Terraria::N
     if (!who.has_finished_connecting())
         return;
 
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(buffs);
-    }
+    broadcast(buffs, who.id());
 }
 
 void Server::client_did_sync_inventory_slot(Badge<Client>, Client& who,
@@ -195,26 +203,14 @@ void Server::client_did_sync_inventory_slot(Badge<Client>, Client& who,
     if (!who.has_finished_connecting())
         return;
 
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(inv_slot);
-    }
+    broadcast(inv_slot, who.id());
 }
 
 void Server::client_did_kill_projectile(Badge<Client>, const Client& who,
                                         const Terraria::Net::Packets::KillProjectile& kill_proj)
 {
     m_projectiles.remove(kill_proj.projectile_id());
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(kill_proj);
-    }
+    broadcast(kill_proj, who.id());
 }
 
 void Server::client_did_toggle_pvp(Badge<Client>, const Client& who, const Terraria::Net::Packets::TogglePvp& toggle)
@@ -225,37 +221,19 @@ void Server::client_did_toggle_pvp(Badge<Client>, const Client& who, const Terra
 
 void Server::client_did_hurt_player(Badge<Client>, Client& who, const Terraria::Net::Packets::PlayerHurt& hurt)
 {
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(hurt);
-    }
+    broadcast(hurt, who.id());
     m_engine->client_did_hurt_player({}, who, hurt);
 }
 
 void Server::client_did_player_death(Badge<Client>, Client& who, const Terraria::Net::Packets::PlayerDeath& death)
 {
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(death);
-    }
+    broadcast(death, who.id());
     m_engine->client_did_player_death({}, who, death);
 }
 
 void Server::client_did_damage_npc(Badge<Client>, Client& who, const Terraria::Net::Packets::DamageNPC& damage_npc)
 {
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(damage_npc);
-    }
+    broadcast(damage_npc, who.id());
     m_engine->client_did_damage_npc({}, who, damage_npc);
 }
 
@@ -272,8 +250,7 @@ void Server::client_did_finish_connecting(Badge<Client>, Client& who)
 
     for (auto& kv : m_projectiles)
     {
-        Terraria::Net::Packets::SyncProjectile sync_projectile;
-        sync_projectile.projectile() = kv.value;
+        auto sync_projectile = kv.value.to_packet();
         who.send(sync_projectile);
     }
 
@@ -281,34 +258,91 @@ void Server::client_did_finish_connecting(Badge<Client>, Client& who)
 }
 
 void Server::client_did_item_animation(Badge<Client>, Client& who,
-                                       const Terraria::Net::Packets::PlayerItemAnimation& item_anim)
+                                       const Terraria::Net::Packets::PlayerItemAnimation::View& item_anim)
 {
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
+    broadcast_near(Terraria::Net::Packets::PlayerItemAnimation::packet_id, item_anim.bytes(), who.player().position(),
+                   who.id());
+}
 
-        kv.value->send(item_anim);
-    }
+void Server::client_did_request_spawn_sections(Badge<Client>, Client& who,
+                                               const Terraria::Net::Packets::SpawnData& spawn_data)
+{
+    // The client asks for its bed as its spawn point, or -1 if it doesn't have one here.
+    Terraria::Point<i32> spawn{spawn_data.spawn_x(), spawn_data.spawn_y()};
+    if (spawn.x() < 0 || spawn.y() < 0 || spawn.x() >= tile_map().width() || spawn.y() >= tile_map().height())
+        spawn = m_world->header().spawn_tile;
+
+    auto spawn_x = clamp<i32>(spawn.x(), 0, tile_map().width() - 1);
+    auto spawn_y = clamp<i32>(spawn.y(), 0, tile_map().height() - 1);
+
+    // Only what's around spawn is sent up front, everything else is streamed in as the player moves around.
+    stream_sections_around(who, {static_cast<u16>(spawn_x), static_cast<u16>(spawn_y)}, [](Client& client) {
+        Terraria::Net::Packets::SpawnPlayerSelf spawn_self;
+        client.send(spawn_self);
+    });
 }
 
-void Server::client_did_request_spawn_sections(Badge<Client>, Client& who, const Terraria::Net::Packets::SpawnData&)
+void Server::stream_sections_around(Client& who, const Terraria::TilePoint& tile,
+                                    Function<void(Client&)> after_sent)
 {
-    for (int i = 0; i < m_world->tile_map()->width() / 100; i++)
+    auto& cache = *m_tile_section_cache;
+    auto& sent_sections = who.sent_sections();
+    if (sent_sections.is_empty())
+        sent_sections.resize(cache.sections_wide() * cache.sections_tall());
+
+    u16 center_x = tile.x() / cache.section_width();
+    u16 center_y = tile.y() / cache.section_height();
+    who.streamed_around_section() = Terraria::TilePoint{center_x, center_y};
+
+    u16 first_x = max(center_x, view_distance_sections_x) - view_distance_sections_x;
+    u16 first_y = max(center_y, view_distance_sections_y) - view_distance_sections_y;
+    u16 last_x = min(center_x + view_distance_sections_x, cache.sections_wide() - 1);
+    u16 last_y = min(center_y + view_distance_sections_y, cache.sections_tall() - 1);
+
+    // Sections are marked as sent as soon as they're asked for, so moving back and forth while they're still being
+    // encoded doesn't ask for them twice.
+    Vector<Terraria::TilePoint> sections;
+    for (u16 y = first_y; y <= last_y; y++)
     {
-        Terraria::Net::Packets::TileSection tile_section(tile_map(), i * 100, 0, 100, m_world->tile_map()->height());
-        who.send(tile_section);
+        for (u16 x = first_x; x <= last_x; x++)
+        {
+            auto index = x + (cache.sections_wide() * y);
+            if (sent_sections[index])
+                continue;
+
+            sent_sections[index] = true;
+            sections.append({x, y});
+        }
+    }
+
+    if (sections.is_empty())
+    {
+        if (after_sent)
+            after_sent(who);
+        return;
     }
 
-    Terraria::Net::Packets::TileFrameSection frame_section;
-    frame_section.set_start_x(0);
-    frame_section.set_start_y(0);
-    frame_section.set_end_x(tile_map().width() / 200);
-    frame_section.set_end_y(tile_map().height() / 150);
-    who.send(frame_section);
+    // Whatever isn't cached is encoded off of the event loop, so everybody else can keep playing in the meantime.
+    cache.ensure_cached(sections, [this, client = who.make_weak_ptr(), sections, first_x, first_y, last_x, last_y,
+                                   after_sent = move(after_sent)]() {
+        if (!client)
+            return;
+
+        for (auto& section : sections)
+            client->send_encoded(m_tile_section_cache->section(section.x(), section.y()));
 
-    Terraria::Net::Packets::SpawnPlayerSelf spawn_self;
-    who.send(spawn_self);
+        // Framing is done by the client over an inclusive range of sections, and framing what it already had again
+        // is harmless.
+        Terraria::Net::Packets::TileFrameSection frame_section;
+        frame_section.set_start_x(first_x);
+        frame_section.set_start_y(first_y);
+        frame_section.set_end_x(last_x);
+        frame_section.set_end_y(last_y);
+        client->send(frame_section);
+
+        if (after_sent)
+            after_sent(*client);
+    });
 }
 
 void Server::client_did_modify_tile(Badge<Client>, Client& who, const Terraria::Net::Packets::ModifyTile& modify_tile)
@@ -317,18 +351,51 @@ void Server::client_did_modify_tile(Badge<Client>, Client& who, const Terraria::
 }
 
 void Server::client_did_sync_tile_picking(Badge<Client>, Client& who,
-                                          const Terraria::Net::Packets::SyncTilePicking& sync_tile_picking)
+                                          const Terraria::Net::Packets::SyncTilePicking::View& sync_tile_picking)
 {
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(sync_tile_picking);
-    }
+    auto tile = sync_tile_picking.position();
+    Terraria::EntityPoint position{tile.x() * 16.0f, tile.y() * 16.0f};
+    broadcast_near(Terraria::Net::Packets::SyncTilePicking::packet_id, sync_tile_picking.bytes(), position, who.id(),
+                   Client::Priority::Low);
     // TODO: Should we save this in the tile? I'm not sure it really pays to save it, or if the game does at all.
 }
 
+void Server::client_did_queue_outbound(Badge<Client>, Client& who)
+{
+    m_clients_to_flush.append(who.make_weak_ptr());
+    if (m_clients_to_flush.size() > 1)
+        return;
+
+    // This runs after everything else the event loop already had to do, so every packet sent in the meantime is
+    // flushed together.
+    deferred_invoke([this]() {
+        auto clients = move(m_clients_to_flush);
+
+        u64 send_calls = 0;
+        u64 sent_packets = 0;
+        for (auto& client : clients)
+        {
+            if (!client)
+                continue;
+
+            auto stats_before = client->outbound_stats();
+            client->flush_outbound();
+            send_calls += client->outbound_stats().send_calls - stats_before.send_calls;
+            sent_packets += client->outbound_stats().sent_packets - stats_before.sent_packets;
+        }
+
+        dbgln_if(OUTBOUND_DEBUG, "Flushed {} packets to {} clients in {} sendmsg calls", sent_packets, clients.size(),
+                 send_calls);
+
+        if constexpr (BUFFER_POOL_DEBUG)
+        {
+            auto pool_stats = BufferPool::stats();
+            dbgln("Buffer pool: {} hits, {} misses, {} bytes in use, {} at most", pool_stats.hits, pool_stats.misses,
+                  pool_stats.bytes_in_use, pool_stats.bytes_in_use_high_water);
+        }
+    });
+}
+
 void Server::client_did_disconnect(Badge<Client>, Client& who, Client::DisconnectReason reason)
 {
     auto id = who.id();
@@ -338,13 +405,13 @@ void Server::client_did_disconnect(Badge<Client>, Client& who, Client::Disconnec
     deferred_invoke([this, id, addr]() {
         outln("Client {}/{} disconnected.", id, addr);
         m_clients.remove(id);
+        m_interest_grid->remove(id);
 
         Terraria::Net::Packets::PlayerActive player_active;
         player_active.set_player_id(id);
         player_active.set_active(0);
 
-        for (auto& kv : m_clients)
-            kv.value->send(player_active);
+        broadcast(player_active);
 
         // Let's remove all of this client's projectiles when they are disconnected
         for (auto& kv : m_projectiles)
@@ -354,8 +421,7 @@ void Server::client_did_disconnect(Badge<Client>, Client& who, Client::Disconnec
                 Terraria::Net::Packets::KillProjectile kill_projectile;
                 kill_projectile.set_projectile_id(kv.key);
                 kill_projectile.set_owner(id);
-                for (auto& client_kv : m_clients)
-                    client_kv.value->send(kill_projectile);
+                broadcast(kill_projectile);
             }
         }
     });
@@ -381,13 +447,7 @@ void Server::client_did_add_player_buff(Badge<Client>, Client& who, const Terrar
         }
     }
 
-    for (auto& kv : m_clients)
-    {
-        if (kv.key == who.id())
-            continue;
-
-        kv.value->send(packet);
-    }
+    broadcast(packet, who.id());
 }
 
 void Server::client_did_sync_talk_npc(Badge<Client>, Client& who, const Terraria::Net::Packets::SyncTalkNPC& packet)
@@ -398,18 +458,71 @@ void Server::client_did_sync_talk_npc(Badge<Client>, Client& who, const Terraria
     else
         who.player().talk_npc() = talk_npc;
 
+    broadcast(packet, who.id());
+}
+
+void Server::client_did_sync_player_team(Badge<Client>, Client& who, const Terraria::Net::Packets::PlayerTeam& packet)
+{
+    m_engine->client_did_sync_player_team({}, who, packet);
+}
+
+void Server::broadcast(const Terraria::Net::Packet& packet, Optional<u8> except,
+                       Function<bool(const Client&)> filter, Client::Priority priority)
+{
+    // Nobody might want it, so it isn't encoded until somebody does.
+    RefPtr<EncodedPacket> encoded;
     for (auto& kv : m_clients)
     {
-        if (kv.key == who.id())
+        if (except.has_value() && kv.key == *except)
             continue;
 
-        kv.value->send(packet);
+        if (filter && !filter(*kv.value))
+            continue;
+
+        if (!encoded)
+            encoded = encode(packet);
+
+        kv.value->send_encoded(*encoded, priority);
     }
 }
 
-void Server::client_did_sync_player_team(Badge<Client>, Client& who, const Terraria::Net::Packets::PlayerTeam& packet)
+void Server::broadcast_near(const Terraria::Net::Packet& packet, const Terraria::EntityPoint& position,
+                            Optional<u8> except, Client::Priority priority)
 {
-    m_engine->client_did_sync_player_team({}, who, packet);
+    broadcast_encoded_near(position, except, priority, [&]() { return encode(packet); });
+}
+
+void Server::broadcast_near(Terraria::Net::Packet::Id id, ReadonlyBytes payload, const Terraria::EntityPoint& position,
+                            Optional<u8> except, Client::Priority priority)
+{
+    broadcast_encoded_near(position, except, priority, [&]() { return EncodedPacket::create(id, payload); });
+}
+
+void Server::broadcast_encoded_near(const Terraria::EntityPoint& position, Optional<u8> except,
+                                    Client::Priority priority, Function<NonnullRefPtr<EncodedPacket>()> encode)
+{
+    RefPtr<EncodedPacket> encoded;
+    m_interest_grid->for_each_interested(position, [&](u8 id) {
+        if (except.has_value() && id == *except)
+            return;
+
+        auto client = m_clients.find(id);
+        if (client == m_clients.end())
+            return;
+
+        if (!encoded)
+            encoded = encode();
+
+        client->value->send_encoded(*encoded, priority);
+    });
+}
+
+NonnullRefPtr<EncodedPacket> Server::encode(const Terraria::Net::Packet& packet)
+{
+    auto encode_start = Time::now_monotonic();
+    auto encoded = EncodedPacket::create(packet);
+    m_packet_stats.record_encode(encoded->id(), Time::now_monotonic() - encode_start);
+    return encoded;
 }
 
 WeakPtr<Client> Server::find_owner_for_item(const Terraria::DroppedItem& item, Optional<u8> ignore_id)
@@ -453,22 +566,16 @@ void Server::client_did_sync_item_owner(Badge<Client>, Client& who, Terraria::Ne
 
     m_dropped_items.set(packet.item_id(), item.release_value());
 
-    for (auto& kv : m_clients)
-        kv.value->send(packet);
+    broadcast(packet);
 
     m_engine->client_did_sync_item_owner({}, who, packet);
 }
 
 void Server::client_did_place_object(Badge<Client>, Client& who, Terraria::Net::Packets::PlaceObject& packet)
 {
-    auto& object = Terraria::s_tile_objects[packet.type()];
-    tile_map().place_object(packet.position(), object, packet.style(), packet.alternate(), packet.random(),
-                            packet.direction());
-    for (auto& kv : m_clients)
-    {
-        if (kv.key != who.id())
-            kv.value->send(packet);
-    }
+    place_object(packet.position(), packet.type(), packet.style(), packet.alternate(), packet.random(),
+                 packet.direction());
+    broadcast(packet, who.id());
 }
 
 i16 Server::next_available_dropped_item_id() const
@@ -490,16 +597,14 @@ i16 Server::sync_dropped_item(i16 id, const Terraria::DroppedItem item)
     sync_item.set_id(id);
     sync_item.dropped_item() = item;
 
-    for (auto& kv : m_clients)
-        kv.value->send(sync_item);
+    broadcast(sync_item);
 
     if (item.owner().has_value() && !m_dropped_items.contains(id))
     {
         Terraria::Net::Packets::SyncItemOwner sync_item_owner;
         sync_item_owner.set_item_id(id);
         sync_item_owner.set_player_id(*item.owner());
-        for (auto& kv : m_clients)
-            kv.value->send(sync_item_owner);
+        broadcast(sync_item_owner);
     }
 
     m_dropped_items.set(id, move(item));
@@ -515,8 +620,7 @@ void Server::remove_dropped_item(i16 id)
     sync_item.set_id(id);
     sync_item.dropped_item().item().set_id(Terraria::Item::Id::None);
 
-    for (auto& kv : m_clients)
-        kv.value->send(sync_item);
+    broadcast(sync_item);
 }
 
 bool Server::listen(AK::IPv4Address addr, u16 port)
@@ -532,6 +636,137 @@ bool Server::listen(AK::IPv4Address addr, u16 port)
 
 int Server::exec() { return m_event_loop.exec(); }
 
+void Server::modify_tile(const Terraria::TileModification& modification)
+{
+    // Anything that makes it into the journal gets replayed on every start, so nothing bad can be let through.
+    if (!tile_map().can_process_tile_modification(modification))
+    {
+        warnln("Ignoring tile modification {} at {}, it doesn't fit the world", modification.action,
+               modification.position);
+        return;
+    }
+
+    if (m_journal)
+        m_journal->log_tile_modification(modification);
+
+    tile_map().process_tile_modification(modification);
+    m_tile_section_cache->invalidate(modification.position);
+}
+
+void Server::place_object(const Terraria::TilePoint& position, i16 type, i16 style, u8 alternate, i8 random,
+                          bool direction)
+{
+    if (type < 0 || type >= Terraria::s_total_tile_objects ||
+        !tile_map().can_place_object(position, Terraria::s_tile_objects[type]))
+    {
+        warnln("Ignoring object {} placed at {}, it doesn't fit the world", type, position);
+        return;
+    }
+
+    if (m_journal)
+        m_journal->log_object_placement(position, type, style, alternate, random, direction);
+
+    auto& object = Terraria::s_tile_objects[type];
+    tile_map().place_object(position, object, style, alternate, random, direction);
+
+    auto root_x = max(0, position.x() - object.origin.x());
+    auto root_y = max(0, position.y() - object.origin.y());
+    m_tile_section_cache->invalidate({static_cast<u16>(root_x), static_cast<u16>(root_y)}, object.width,
+                                     object.height);
+}
+
+void Server::start_autosaving(String path, int interval_ms)
+{
+    m_autosave_path = move(path);
+    m_autosave_timer = Core::Timer::create_repeating(interval_ms, [this] { autosave(); }, this);
+    m_autosave_timer->start();
+}
+
+void Server::start_dumping_packet_stats(int interval_ms)
+{
+    m_packet_stats_timer = Core::Timer::create_repeating(interval_ms, [this] { dump_packet_stats(); }, this);
+    m_packet_stats_timer->start();
+}
+
+void Server::dump_packet_stats() const
+{
+    auto average_us = [](const PacketStats::Histogram& histogram) -> u64 {
+        if (histogram.count() == 0)
+            return 0;
+        return histogram.total_microseconds() / histogram.count();
+    };
+
+    outln("Inbound packets:");
+    m_packet_stats.for_each(PacketStats::Direction::Inbound, [&](auto id, auto& counters) {
+        outln("  {}: {} packets, {} bytes, {}us decoding and {}us handling on average", id, counters.packets,
+              counters.bytes, average_us(counters.decode_time), average_us(counters.handle_time));
+    });
+
+    outln("Outbound packets:");
+    m_packet_stats.for_each(PacketStats::Direction::Outbound, [&](auto id, auto& counters) {
+        outln("  {}: {} packets, {} bytes, {} encodes taking {}us on average", id, counters.packets, counters.bytes,
+              counters.encode_time.count(), average_us(counters.encode_time));
+    });
+}
+
+void Server::autosave()
+{
+    if (m_autosave_thread)
+    {
+        m_autosave_stats.skipped++;
+        dbgln("Skipping autosave, the last one is still being written");
+        return;
+    }
+
+    auto snapshot_start = Time::now_monotonic();
+    auto snapshot = m_world->snapshot();
+    // Everything journaled up until now is in the snapshot, so it only needs keeping until the snapshot is saved.
+    if (m_journal)
+        m_journal->checkpoint();
+    auto snapshot_pause_us = (Time::now_monotonic() - snapshot_start).to_microseconds();
+
+    m_autosave_stats.last_snapshot_pause_us = snapshot_pause_us;
+    m_autosave_stats.max_snapshot_pause_us = max(m_autosave_stats.max_snapshot_pause_us, snapshot_pause_us);
+
+    m_autosave_thread = Threading::Thread::construct(
+        [this, snapshot = move(snapshot), path = m_autosave_path]() -> intptr_t {
+            Core::ElapsedTimer timer;
+            timer.start();
+            auto result = snapshot->save_to_file(path);
+            i64 duration_ms = timer.elapsed();
+
+            Optional<String> error;
+            if (result.is_error())
+                error = String::formatted("{}", result.error());
+
+            // We're not on the event loop's thread, so the results have to be handed back to it.
+            m_event_loop.deferred_invoke([this, error = move(error), duration_ms, path]() {
+                (void)m_autosave_thread->join();
+                m_autosave_thread = nullptr;
+
+                if (error.has_value())
+                {
+                    m_autosave_stats.failed++;
+                    warnln("Failed to autosave world to {}: {}", path, *error);
+                    return;
+                }
+
+                if (m_journal)
+                    m_journal->discard_checkpoint();
+
+                m_autosave_stats.completed++;
+                m_autosave_stats.last_save_duration_ms = duration_ms;
+                m_autosave_stats.max_save_duration_ms = max(m_autosave_stats.max_save_duration_ms, duration_ms);
+                outln("Autosaved world to {} in {}ms, the snapshot held up the event loop for {}us", path, duration_ms,
+                      m_autosave_stats.last_snapshot_pause_us);
+            });
+            m_event_loop.wake();
+            return 0;
+        },
+        "Autosave"sv);
+    m_autosave_thread->start();
+}
+
 const WeakPtr<Client> Server::client(u8 id) const
 {
     auto client = m_clients.get(id);
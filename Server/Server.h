@@ -10,6 +10,7 @@
 #include <AK/HashMap.h>
 #include <LibCore/EventLoop.h>
 #include <LibCore/TCPServer.h>
+#include <LibCore/Timer.h>
 #include <LibTerraria/DroppedItem.h>
 #include <LibTerraria/Net/Packets/AddPlayerBuff.h>
 #include <LibTerraria/Net/Packets/DamageNPC.h>
@@ -35,9 +36,14 @@
 #include <LibTerraria/Net/Packets/SyncTilePicking.h>
 #include <LibTerraria/Net/Packets/TogglePvp.h>
 #include <LibTerraria/Projectile.h>
+#include <LibTerraria/TileJournal.h>
 #include <LibTerraria/TileMap.h>
 #include <LibTerraria/World.h>
+#include <LibThreading/Thread.h>
 #include <Server/Client.h>
+#include <Server/InterestGrid.h>
+#include <Server/PacketStats.h>
+#include <Server/TileSectionCache.h>
 
 namespace Scripting
 {
@@ -55,9 +61,42 @@ public:
 
     int exec();
 
+    // How many tile sections (200x150 tiles each) around a player they are sent in each direction.
+    static constexpr u16 view_distance_sections_x = 2;
+    static constexpr u16 view_distance_sections_y = 1;
+
+    struct AutosaveStats
+    {
+        u32 completed{};
+        u32 failed{};
+        // Autosaves that came around while the previous one was still being written.
+        u32 skipped{};
+        // How long the event loop was held up taking the snapshot, which is the only part of saving it waits for.
+        i64 last_snapshot_pause_us{};
+        i64 max_snapshot_pause_us{};
+        // How long the autosave thread took to write the snapshot out.
+        i64 last_save_duration_ms{};
+        i64 max_save_duration_ms{};
+    };
+
+    // Every change to the tile map should go through these, so that it makes it into the journal.
+    void modify_tile(const Terraria::TileModification&);
+
+    void place_object(const Terraria::TilePoint& position, i16 type, i16 style, u8 alternate, i8 random,
+                      bool direction);
+
+    void set_journal(OwnPtr<Terraria::TileJournal> journal) { m_journal = move(journal); }
+
+    // Every interval, snapshots the world and writes it to path on a thread of its own.
+    void start_autosaving(String path, int interval_ms);
+
+    void autosave();
+
+    const AutosaveStats& autosave_stats() const { return m_autosave_stats; }
+
     void client_did_send_message(Badge<Client>, const Client&, const String&);
 
-    void client_did_sync_player(Badge<Client>, const Client&, Terraria::Net::Packets::SyncPlayer&);
+    void client_did_sync_player(Badge<Client>, Client&, Terraria::Net::Packets::SyncPlayer&);
 
     void client_did_request_world_data(Badge<Client>, Client&);
 
@@ -89,16 +128,19 @@ public:
 
     void client_did_finish_connecting(Badge<Client>, Client&);
 
-    void client_did_item_animation(Badge<Client>, Client&, const Terraria::Net::Packets::PlayerItemAnimation&);
+    void client_did_item_animation(Badge<Client>, Client&, const Terraria::Net::Packets::PlayerItemAnimation::View&);
 
     void client_did_request_spawn_sections(Badge<Client>, Client&, const Terraria::Net::Packets::SpawnData&);
 
     void client_did_modify_tile(Badge<Client>, Client&, const Terraria::Net::Packets::ModifyTile&);
 
-    void client_did_sync_tile_picking(Badge<Client>, Client&, const Terraria::Net::Packets::SyncTilePicking&);
+    void client_did_sync_tile_picking(Badge<Client>, Client&, const Terraria::Net::Packets::SyncTilePicking::View&);
 
     void client_did_disconnect(Badge<Client>, Client&, Client::DisconnectReason);
 
+    // The client has packets queued up to send, and wants to be flushed once this event loop iteration is done.
+    void client_did_queue_outbound(Badge<Client>, Client&);
+
     void client_did_add_player_buff(Badge<Client>, Client&, const Terraria::Net::Packets::AddPlayerBuff&);
 
     void client_did_sync_talk_npc(Badge<Client>, Client&, const Terraria::Net::Packets::SyncTalkNPC&);
@@ -135,9 +177,50 @@ public:
 
     void remove_dropped_item(i16 id);
 
+    // Encodes the packet once, and queues that up for every client but the one with this id, and only the ones the
+    // filter accepts if there is one.
+    void broadcast(const Terraria::Net::Packet&, Optional<u8> except = {}, Function<bool(const Client&)> filter = {},
+                   Client::Priority = Client::Priority::Normal);
+
+    // Same as above, but only to the clients close enough to this position to see it.
+    void broadcast_near(const Terraria::Net::Packet&, const Terraria::EntityPoint&, Optional<u8> except = {},
+                        Client::Priority = Client::Priority::Normal);
+
+    // Relays a packet exactly as it was received, without decoding it and encoding it back first.
+    void broadcast_near(Terraria::Net::Packet::Id, ReadonlyBytes payload, const Terraria::EntityPoint&,
+                        Optional<u8> except = {}, Client::Priority = Client::Priority::Normal);
+
+    const InterestGrid& interest_grid() const { return *m_interest_grid; }
+
+    Terraria::Net::PacketDispatcher<Client>& packet_dispatcher() { return m_packet_dispatcher; }
+
+    // Everybody's packets counted together.
+    PacketStats& packet_stats() { return m_packet_stats; }
+
+    const PacketStats& packet_stats() const { return m_packet_stats; }
+
+    // Every interval, prints out how many of every packet went in and out, and how long they took.
+    void start_dumping_packet_stats(int interval_ms);
+
+    void dump_packet_stats() const;
+
     WeakPtr<Client> find_owner_for_item(const Terraria::DroppedItem&, Optional<u8> ignore_id);
 
 private:
+    // What was dropped while two players couldn't see each other has to be caught up on once they can.
+    void players_did_come_into_range(Client&, Client&);
+
+    // Sends every section within view distance of this tile that the client doesn't have yet, and frames them.
+    // after_sent is called once they have been, even if there was nothing to send.
+    void stream_sections_around(Client&, const Terraria::TilePoint&, Function<void(Client&)> after_sent = {});
+
+    // Nobody might be close enough to want it, so the packet isn't encoded until somebody is.
+    void broadcast_encoded_near(const Terraria::EntityPoint&, Optional<u8> except, Client::Priority,
+                                Function<NonnullRefPtr<EncodedPacket>()> encode);
+
+    // Encodes the packet, counting how long it took. Clients count their own, this is for broadcasts.
+    NonnullRefPtr<EncodedPacket> encode(const Terraria::Net::Packet&);
+
     OwnPtr<Scripting::Engine> m_engine;
     NonnullRefPtr<Core::TCPServer> m_server;
     HashMap<u8, NonnullOwnPtr<Client>> m_clients;
@@ -145,4 +228,15 @@ private:
     HashMap<i16, Terraria::Projectile> m_projectiles;
     HashMap<i16, Terraria::DroppedItem> m_dropped_items;
     RefPtr<Terraria::World> m_world;
+    String m_autosave_path;
+    RefPtr<Core::Timer> m_autosave_timer;
+    RefPtr<Threading::Thread> m_autosave_thread;
+    OwnPtr<Terraria::TileJournal> m_journal;
+    OwnPtr<TileSectionCache> m_tile_section_cache;
+    OwnPtr<InterestGrid> m_interest_grid;
+    Vector<WeakPtr<Client>> m_clients_to_flush;
+    AutosaveStats m_autosave_stats;
+    Terraria::Net::PacketDispatcher<Client> m_packet_dispatcher;
+    PacketStats m_packet_stats;
+    RefPtr<Core::Timer> m_packet_stats_timer;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <LibTerraria/Net/Packets/TileSection.h>
+#include <Server/TileSectionCache.h>
+#include <unistd.h>
+
+// FIXME: Do what Serenity does with their debug macros
+#define TILE_SECTION_CACHE_DEBUG 0
+
+TileSectionCache::TileSectionCache(const Terraria::TileMap& tile_map, u16 section_width, u16 section_height,
+                                   Core::EventLoop& event_loop)
+    : m_tile_map(tile_map), m_event_loop(event_loop),
+      m_workers(max<long>(sysconf(_SC_NPROCESSORS_ONLN), 1), "Tile section encoding"sv),
+      m_section_width(section_width), m_section_height(section_height),
+      m_sections_wide((tile_map.width() + section_width - 1) / section_width),
+      m_sections_tall((tile_map.height() + section_height - 1) / section_height)
+{
+    m_sections.resize(m_sections_wide * m_sections_tall);
+    m_generations.resize(m_sections_wide * m_sections_tall);
+}
+
+NonnullRefPtr<EncodedPacket> TileSectionCache::encode(u16 section_x, u16 section_y) const
+{
+    Terraria::Net::Packets::TileSection tile_section(m_tile_map, section_x * m_section_width,
+                                                     section_y * m_section_height, width_of(section_x),
+                                                     height_of(section_y));
+    return EncodedPacket::create(tile_section);
+}
+
+NonnullRefPtr<EncodedPacket> TileSectionCache::encode(Span<const Terraria::Tile> tiles, u16 section_x,
+                                                      u16 section_y) const
+{
+    Terraria::Net::Packets::TileSection tile_section(tiles, section_x * m_section_width, section_y * m_section_height,
+                                                     width_of(section_x), height_of(section_y));
+    return EncodedPacket::create(tile_section);
+}
+
+Vector<Terraria::Tile> TileSectionCache::copy_section(u16 section_x, u16 section_y) const
+{
+    u16 x = section_x * m_section_width;
+    u16 y = section_y * m_section_height;
+    auto width = width_of(section_x);
+    auto height = height_of(section_y);
+
+    Vector<Terraria::Tile> tiles;
+    tiles.ensure_capacity(width * height);
+    for (u16 row = y; row < y + height; row++)
+    {
+        for (u16 column = 0; column < width;)
+        {
+            auto span = m_tile_map.row_span({static_cast<u16>(x + column), row}, width - column);
+            tiles.append(span.data(), span.size());
+            column += span.size();
+        }
+    }
+
+    return tiles;
+}
+
+NonnullRefPtr<EncodedPacket> TileSectionCache::section(u16 section_x, u16 section_y)
+{
+    VERIFY(section_x < m_sections_wide && section_y < m_sections_tall);
+    auto& section = m_sections[index_of(section_x, section_y)];
+    if (section)
+    {
+        m_hits++;
+        return *section;
+    }
+
+    m_misses++;
+    auto encoded = encode(section_x, section_y);
+    section = encoded;
+
+    dbgln_if(TILE_SECTION_CACHE_DEBUG, "Encoded tile section {},{} ({} bytes), {} hits and {} misses so far",
+             section_x, section_y, encoded->size(), m_hits, m_misses);
+
+    return encoded;
+}
+
+void TileSectionCache::invalidate(const Terraria::TilePoint& position, u16 width, u16 height)
+{
+    if (width == 0 || height == 0)
+        return;
+
+    auto first_x = position.x() / m_section_width;
+    auto first_y = position.y() / m_section_height;
+    auto last_x = min((position.x() + width - 1) / m_section_width, m_sections_wide - 1);
+    auto last_y = min((position.y() + height - 1) / m_section_height, m_sections_tall - 1);
+
+    for (auto y = first_y; y <= last_y; y++)
+    {
+        for (auto x = first_x; x <= last_x; x++)
+        {
+            auto index = index_of(x, y);
+            m_sections[index].clear();
+            m_generations[index]++;
+        }
+    }
+}
+
+void TileSectionCache::ensure_cached(const Vector<Terraria::TilePoint>& sections, Function<void()> on_ready)
+{
+    Vector<Terraria::TilePoint> missing;
+    for (auto& section : sections)
+    {
+        if (!m_sections[index_of(section.x(), section.y())])
+            missing.append(section);
+    }
+
+    if (missing.is_empty())
+    {
+        on_ready();
+        return;
+    }
+
+    auto pending = adopt_ref(*new PendingSections);
+    pending->remaining = missing.size();
+    pending->on_ready = move(on_ready);
+
+    for (auto& section : missing)
+    {
+        // The tile map keeps changing on the event loop while the workers read it, so they get a copy of their own.
+        auto index = index_of(section.x(), section.y());
+        auto tiles = copy_section(section.x(), section.y());
+        m_workers.submit([this, tiles = move(tiles), pending, section, index, generation = m_generations[index]]() {
+            auto packet = encode(tiles.span(), section.x(), section.y());
+
+            m_event_loop.deferred_invoke([this, pending, index, generation, packet = move(packet)]() mutable {
+                if (m_generations[index] == generation && !m_sections[index])
+                {
+                    m_misses++;
+                    m_sections[index] = move(packet);
+                }
+
+                if (--pending->remaining == 0)
+                    pending->on_ready();
+            });
+            m_event_loop.wake();
+        });
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/RefCounted.h>
+#include <AK/Vector.h>
+#include <LibCore/EventLoop.h>
+#include <LibTerraria/Point.h>
+#include <LibTerraria/TileMap.h>
+#include <Server/EncodedPacket.h>
+#include <Server/WorkerPool.h>
+
+// Encoding and compressing a TileSection is by far the most expensive thing we do for a client, and almost every
+// client asks for the same ones. This keeps the finished packet of every section around until a tile inside of it
+// changes, so sending it again is only a matter of queueing it up.
+class TileSectionCache
+{
+public:
+    // Sections that aren't cached are encoded on worker threads, which hand them back through the event loop.
+    TileSectionCache(const Terraria::TileMap&, u16 section_width, u16 section_height, Core::EventLoop&);
+
+    u16 section_width() const { return m_section_width; }
+
+    u16 section_height() const { return m_section_height; }
+
+    u16 sections_wide() const { return m_sections_wide; }
+
+    u16 sections_tall() const { return m_sections_tall; }
+
+    // The whole TileSection packet for this section, ready for Client::send_encoded(). If it isn't cached, it's
+    // encoded right here on the event loop.
+    NonnullRefPtr<EncodedPacket> section(u16 section_x, u16 section_y);
+
+    // Encodes every one of these sections that isn't cached on the worker pool, from a copy of just their tiles, and
+    // calls back on the event loop once all of them are. A section that changed while it was being encoded isn't
+    // cached, so section() would encode it again then.
+    void ensure_cached(const Vector<Terraria::TilePoint>& sections, Function<void()> on_ready);
+
+    // Throws away every section touching this rect of tiles, so the next time one is asked for it's encoded again.
+    void invalidate(const Terraria::TilePoint& position, u16 width = 1, u16 height = 1);
+
+    u64 hits() const { return m_hits; }
+
+    u64 misses() const { return m_misses; }
+
+private:
+    struct PendingSections : public RefCounted<PendingSections>
+    {
+        size_t remaining{};
+        Function<void()> on_ready;
+    };
+
+    ALWAYS_INLINE size_t index_of(u16 section_x, u16 section_y) const
+    {
+        return section_x + (m_sections_wide * section_y);
+    }
+
+    // Sections at the right and bottom edges of the world can be smaller than the rest.
+    u16 width_of(u16 section_x) const { return min(m_section_width, m_tile_map.width() - section_x * m_section_width); }
+
+    u16 height_of(u16 section_y) const
+    {
+        return min(m_section_height, m_tile_map.height() - section_y * m_section_height);
+    }
+
+    // Reads the tiles straight out of the world, so this can only be done on the event loop.
+    NonnullRefPtr<EncodedPacket> encode(u16 section_x, u16 section_y) const;
+
+    // From tiles copy_section() gave back, which can be done anywhere.
+    NonnullRefPtr<EncodedPacket> encode(Span<const Terraria::Tile>, u16 section_x, u16 section_y) const;
+
+    // Copies just the tiles of this section out of the world, a row at a time, for a worker to encode while the world
+    // keeps changing. Snapshotting the whole map would be far more expensive for most kinds of them.
+    Vector<Terraria::Tile> copy_section(u16 section_x, u16 section_y) const;
+
+    const Terraria::TileMap& m_tile_map;
+    Core::EventLoop& m_event_loop;
+    WorkerPool m_workers;
+    u16 m_section_width;
+    u16 m_section_height;
+    u16 m_sections_wide;
+    u16 m_sections_tall;
+    Vector<RefPtr<EncodedPacket>> m_sections;
+    // Bumped every time a section is invalidated, so an encoding started before then can tell it's out of date.
+    Vector<u32> m_generations;
+    u64 m_hits{};
+    u64 m_misses{};
+};
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <Server/WorkerPool.h>
+
+WorkerPool::WorkerPool(size_t thread_count, StringView name)
+{
+    VERIFY(thread_count > 0);
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        auto thread = Threading::Thread::construct([this]() { return work(); }, name);
+        thread->start();
+        m_threads.append(move(thread));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        Threading::MutexLocker locker(m_mutex);
+        m_stopping = true;
+        m_job_queued.broadcast();
+    }
+
+    for (auto& thread : m_threads)
+        (void)thread->join();
+}
+
+void WorkerPool::submit(Function<void()> job)
+{
+    Threading::MutexLocker locker(m_mutex);
+    m_jobs.append(move(job));
+    m_job_queued.signal();
+}
+
+intptr_t WorkerPool::work()
+{
+    for (;;)
+    {
+        Function<void()> job;
+        {
+            Threading::MutexLocker locker(m_mutex);
+            while (m_jobs.is_empty() && !m_stopping)
+                m_job_queued.wait();
+
+            if (m_stopping)
+                return 0;
+
+            job = m_jobs.take_first();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2021, James Puleo <james@jame.xyz>
+ *
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#pragma once
+
+#include <AK/Function.h>
+#include <AK/StringView.h>
+#include <AK/Vector.h>
+#include <LibThreading/ConditionVariable.h>
+#include <LibThreading/Mutex.h>
+#include <LibThreading/Thread.h>
+
+// A fixed set of threads that take jobs off of a shared queue, in the order they were submitted.
+// Jobs run off of the event loop, so anything they hand back has to go through Core::EventLoop::deferred_invoke.
+class WorkerPool
+{
+public:
+    WorkerPool(size_t thread_count, StringView name);
+
+    // Waits for whatever is running to finish, anything still queued is dropped.
+    ~WorkerPool();
+
+    size_t thread_count() const { return m_threads.size(); }
+
+    void submit(Function<void()>);
+
+private:
+    intptr_t work();
+
+    Threading::Mutex m_mutex;
+    Threading::ConditionVariable m_job_queued{m_mutex};
+    Vector<Function<void()>> m_jobs;
+    bool m_stopping{false};
+    Vector<NonnullRefPtr<Threading::Thread>> m_threads;
+};
@@ -5,39 +5,144 @@
  */
 
 #include <LibCore/ArgsParser.h>
+#include <LibCore/ElapsedTimer.h>
 #include <LibCore/File.h>
+#include <LibCore/MappedFile.h>
 #include <LibMain/Main.h>
+#include <LibTerraria/TileJournal.h>
 #include <LibTerraria/World.h>
 #include <Server/Server.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 
 static Server* s_server;
 
 Server& server() { return *s_server; }
 
+static ErrorOr<NonnullRefPtr<Terraria::World>> load_world_from_mapped_file(const String& world_path,
+                                                                          Terraria::World::TileStorage tile_storage)
+{
+    // The mapping is released as soon as we return, once the tile map has been populated.
+    auto mapped_file = TRY(Core::MappedFile::map(world_path));
+
+    // We read the world front to back exactly once, let the kernel know so it can read ahead aggressively.
+    posix_madvise(mapped_file->data(), mapped_file->size(), POSIX_MADV_SEQUENTIAL);
+
+    return Terraria::World::try_load_world(mapped_file->bytes(), tile_storage);
+}
+
+static ErrorOr<NonnullRefPtr<Terraria::World>> load_world_lazily(const String& world_path)
+{
+    auto mapped_file = TRY(Core::MappedFile::map(world_path));
+    return Terraria::World::try_load_world_lazily(move(mapped_file));
+}
+
+static ErrorOr<NonnullRefPtr<Terraria::World>> load_world_from_buffer(const String& world_path,
+                                                                     Terraria::World::TileStorage tile_storage)
+{
+    auto file = TRY(Core::File::open(world_path, Core::OpenMode::ReadOnly));
+    auto file_bytes = file->read_all();
+
+    return Terraria::World::try_load_world(file_bytes, tile_storage);
+}
+
 ErrorOr<int> serenity_main(Main::Arguments arguments)
 {
     Core::ArgsParser args_parser;
 
     String world_path;
+    bool read_all = false;
+    bool lazy = false;
+    String tile_map_kind = "memory";
+    int autosave_interval = 0;
+    bool journal = false;
+    int stats_interval = 0;
 
+    args_parser.add_option(read_all, "Read the whole world file into memory instead of mapping it", "read-all", 0);
+    args_parser.add_option(lazy, "Decode tiles as they are needed, finishing the rest in the background", "lazy", 0);
+    args_parser.add_option(tile_map_kind, "How to store tiles in memory: memory, chunked or paletted", "tile-map", 0,
+                           "kind");
+    args_parser.add_option(autosave_interval, "Save the world every this many seconds, 0 to never save", "autosave",
+                           0, "seconds");
+    args_parser.add_option(journal, "Journal every tile change, replaying them on top of the world on startup",
+                           "journal", 0);
+    args_parser.add_option(stats_interval, "Print out packet stats every this many seconds, 0 to never print them",
+                           "stats-interval", 0, "seconds");
     args_parser.add_positional_argument(world_path, "Path to the world file", "world");
 
     if (!args_parser.parse(arguments))
         return 1;
 
-    auto file = TRY(Core::File::open(world_path, Core::OpenMode::ReadOnly));
+    if (lazy && read_all)
+    {
+        warnln("Lazy loading needs the world file to be mapped, it can't be used with --read-all.");
+        return 1;
+    }
 
-    auto file_bytes = file->read_all();
-    InputMemoryStream bytes_stream(file_bytes);
+    Terraria::World::TileStorage tile_storage;
+    if (tile_map_kind == "memory")
+        tile_storage = Terraria::World::TileStorage::Memory;
+    else if (tile_map_kind == "chunked")
+        tile_storage = Terraria::World::TileStorage::Chunked;
+    else if (tile_map_kind == "paletted")
+        tile_storage = Terraria::World::TileStorage::Paletted;
+    else
+    {
+        warnln("Unknown tile map \"{}\", expected memory, chunked or paletted.", tile_map_kind);
+        return 1;
+    }
+
+    if (lazy && tile_storage != Terraria::World::TileStorage::Memory)
+    {
+        warnln("Lazy loading has its own tile map, it can't be used with --tile-map.");
+        return 1;
+    }
+
+    Core::ElapsedTimer load_timer;
+    load_timer.start();
 
-    auto world = TRY(Terraria::World::try_load_world(bytes_stream));
+    auto world = TRY(lazy       ? load_world_lazily(world_path)
+                     : read_all ? load_world_from_buffer(world_path, tile_storage)
+                                : load_world_from_mapped_file(world_path, tile_storage));
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    outln("Loaded world \"{}\" ({}x{}) in {}ms using {} into a {} tile map, peak RSS is {} KiB",
+          world->header().name, world->header().max_tiles_x, world->header().max_tiles_y, load_timer.elapsed(),
+          lazy ? "lazy mmap" : read_all ? "read_all" : "mmap", lazy ? "lazy" : tile_map_kind, usage.ru_maxrss);
+
+    OwnPtr<Terraria::TileJournal> tile_journal;
+    if (journal)
+    {
+        auto journal_path = String::formatted("{}.journal", world_path);
+
+        Core::ElapsedTimer replay_timer;
+        replay_timer.start();
+        auto replayed = TRY(Terraria::TileJournal::replay(journal_path, *world->tile_map()));
+        if (replayed > 0)
+            outln("Replayed {} tile changes from {} in {}ms", replayed, journal_path, replay_timer.elapsed());
+
+        tile_journal = TRY(Terraria::TileJournal::open(journal_path));
+    }
 
     s_server = new Server(world);
+    s_server->set_journal(move(tile_journal));
     if (!s_server->listen())
     {
         warnln("Server failed to listen.");
         return 4;
     }
 
+    if (autosave_interval > 0)
+    {
+        if (tile_storage != Terraria::World::TileStorage::Chunked)
+            warnln("Autosaving has to copy every tile to snapshot the world, --tile-map chunked only copies pointers.");
+
+        s_server->start_autosaving(world_path, autosave_interval * 1000);
+    }
+
+    if (stats_interval > 0)
+        s_server->start_dumping_packet_stats(stats_interval * 1000);
+
     return s_server->exec();
 }